@@ -0,0 +1,689 @@
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+#include "leptjson/binary.h"
+#include "leptjson/bind.h"
+#include "leptjson/lazy.h"
+#include "leptjson/leptjson.h"
+#include "leptjson/lines.h"
+#include "leptjson/parallel.h"
+#include "leptjson/tape.h"
+#include "leptjson/writer.h"
+
+/* every operator new in the process, the library's included, arena blocks too */
+static std::atomic<size_t> g_allocs(0);
+
+void* operator new(size_t n) {
+    g_allocs.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = malloc(n ? n : 1)) return p;
+    throw std::bad_alloc();
+}
+void* operator new[](size_t n) { return operator new(n); }
+void* operator new(size_t n, const std::nothrow_t&) noexcept {
+    g_allocs.fetch_add(1, std::memory_order_relaxed);
+    return malloc(n ? n : 1);
+}
+void* operator new[](size_t n, const std::nothrow_t& t) noexcept { return operator new(n, t); }
+void operator delete(void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+void operator delete[](void* p, size_t) noexcept { free(p); }
+
+namespace lept {
+using std::cout;
+using std::string;
+
+/* ---- corpus: synthetic documents of the usual shapes, the same bytes on every run ---- */
+
+static void append_format(string& json, const char* fmt, double n) {
+    char buf[40];
+    json.append(buf, snprintf(buf, sizeof(buf), fmt, n));
+}
+
+/* records with the usual mix of small objects, short strings and numbers */
+static string make_records(size_t count) {
+    string json = "[";
+    for (size_t i = 0; i < count; ++i) {
+        if (i) json += ',';
+        json += "{\"id\":" + std::to_string(i) + ",\"name\":\"user" + std::to_string(i) +
+                "\",\"score\":" + std::to_string(i * 0.25) +
+                ",\"active\":true,\"tags\":[\"a\",\"bb\",\"ccc\"],\"pos\":{\"x\":1.5,\"y\":-2}}";
+    }
+    json += "]";
+    return json;
+}
+
+/* integers, short decimals, full doubles and exponents */
+static string make_numbers(size_t count) {
+    std::mt19937 rng(1);
+    string json = "[";
+    for (size_t i = 0; i < count; ++i) {
+        if (i) json += ',';
+        switch (rng() % 4) {
+            case 0: json += std::to_string(rng() % 100000); break;
+            case 1: append_format(json, "%.3f", -(double)(rng() % 1000000) / 1000); break;
+            case 2: append_format(json, "%.17g", (double)rng() / rng.max() * 1e6); break;
+            default: {
+                const double m = rng(); /* one draw per statement keeps the sequence portable */
+                append_format(json, "%.6e", m * (rng() % 2 ? 1 : 1e-300));
+                break;
+            }
+        }
+    }
+    json += "]";
+    return json;
+}
+
+/* text with escapes, raw UTF-8 and \u escapes including surrogate pairs */
+static string make_strings(size_t count) {
+    static const char* const words[] = {"lorem", "ipsum", "dolor", "sit", "amet", "consectetur",
+                                        "caf\xc3\xa9", "\xe4\xb8\xad\xe6\x96\x87", "line\\n",
+                                        "\\\"quoted\\\"", "tab\\t", "\\u00e9t\\u00e9",
+                                        "\\ud83d\\ude00", "path\\/to"};
+    std::mt19937 rng(2);
+    string json = "[";
+    for (size_t i = 0; i < count; ++i) {
+        json += i ? ",\"" : "\"";
+        for (size_t n = 1 + rng() % 12; n; --n) {
+            json += words[rng() % (sizeof(words) / sizeof(words[0]))];
+            if (n > 1) json += ' ';
+        }
+        json += '"';
+    }
+    json += "]";
+    return json;
+}
+
+/* elements nested depth levels deep, arrays and objects alternating */
+static string make_nested(size_t count, size_t depth) {
+    string open, close;
+    for (size_t d = 0; d < depth; ++d) {
+        open += d % 2 ? "{\"k\":" : "[1,";
+        close.insert(0, d % 2 ? "}" : "]");
+    }
+    string json = "[";
+    for (size_t i = 0; i < count; ++i) {
+        if (i) json += ',';
+        json += open + std::to_string(i) + close;
+    }
+    json += "]";
+    return json;
+}
+
+/* one object with many members, big enough for the key index */
+static string make_wide(size_t count) {
+    string json = "{";
+    char key[32];
+    for (size_t i = 0; i < count; ++i) {
+        if (i) json += ',';
+        json.append(key, snprintf(key, sizeof(key), "\"field_%06zu\":", i));
+        switch (i % 4) {
+            case 0: json += std::to_string(i); break;
+            case 1: json += "\"value " + std::to_string(i) + "\""; break;
+            case 2: json += i % 8 == 2 ? "true" : "false"; break;
+            default: json += "null"; break;
+        }
+    }
+    json += "}";
+    return json;
+}
+
+/* like twitter.json: statuses with a nested user, entities, long ids, nulls and CJK text */
+static string make_twitter(size_t count) {
+    std::mt19937 rng(3);
+    string json = "{\"statuses\":[";
+    for (size_t i = 0; i < count; ++i) {
+        const string id = std::to_string(505874924095815681ull + i * 7919);
+        const string uid = std::to_string(1186275104u + rng() % 100000000);
+        unsigned counts[6];
+        for (unsigned& n : counts) n = rng() % 10000;
+        if (i) json += ',';
+        json += "{\"metadata\":{\"result_type\":\"recent\",\"iso_language_code\":\"ja\"},"
+                "\"created_at\":\"Sun Aug 31 00:29:15 +0000 2014\",\"id\":" + id + ",\"id_str\":\"" + id +
+                "\",\"text\":\"@aym0566x \\n\\n\xe5\x90\x8d\xe5\x89\x8d:\xe5\x89\x8d\xe7\x94\xb0\xe3\x81\x82"
+                "\xe3\x82\x86\xe3\x81\xbf \\u261e #\xe7\xb5\x90\xe5\xa9\x9a\","
+                "\"source\":\"<a href=\\\"http://twitter.com/download/iphone\\\" rel=\\\"nofollow\\\">Twitter for "
+                "iPhone</a>\",\"truncated\":false,\"in_reply_to_status_id\":null,\"in_reply_to_user_id\":null,"
+                "\"user\":{\"id\":" + uid + ",\"id_str\":\"" + uid + "\",\"name\":\"AYUMI\",\"screen_name\":"
+                "\"ayuu0123\",\"location\":\"\xe6\x9d\xb1\xe4\xba\xac\",\"description\":\"\xe5\x85\x83\xe9\x87"
+                "\x8e\xe7\x90\x83\xe9\x83\xa8\xe3\x83\x9e\xe3\x83\x8d\xe3\x83\xbc\xe3\x82\xb8\xe3\x83\xa3\xe3\x83"
+                "\xbc\",\"url\":null,\"protected\":false,\"followers_count\":" + std::to_string(counts[0]) +
+                ",\"friends_count\":" + std::to_string(counts[1]) + ",\"listed_count\":0,\"created_at\":"
+                "\"Tue Feb 12 17:34:05 +0000 2013\",\"favourites_count\":" + std::to_string(counts[2]) +
+                ",\"utc_offset\":null,\"time_zone\":null,\"geo_enabled\":false,\"verified\":false,"
+                "\"statuses_count\":" + std::to_string(counts[3]) + ",\"lang\":\"ja\","
+                "\"profile_background_color\":\"C0DEED\",\"profile_image_url\":\"http://pbs.twimg.com/"
+                "profile_images/497760886795153410/LDjAwR_y_normal.jpeg\",\"following\":false},"
+                "\"geo\":null,\"coordinates\":null,\"place\":null,\"retweet_count\":" + std::to_string(counts[4]) +
+                ",\"favorite_count\":" + std::to_string(counts[5]) + ",\"entities\":{\"hashtags\":[{\"text\":"
+                "\"\xe7\xb5\x90\xe5\xa9\x9a\",\"indices\":[47,50]}],\"symbols\":[],\"urls\":[],\"user_mentions\":"
+                "[{\"screen_name\":\"aym0566x\",\"name\":\"\xe5\x89\x8d\xe7\x94\xb0\",\"id\":" + uid +
+                ",\"id_str\":\"" + uid + "\",\"indices\":[0,9]}]},\"favorited\":false,\"retweeted\":false,"
+                "\"lang\":\"ja\"}";
+    }
+    json += "],\"search_metadata\":{\"completed_in\":0.087,\"max_id\":505874924095815681,\"count\":100}}";
+    return json;
+}
+
+/* like canada.json: a polygon of long coordinate pairs */
+static string make_canada(size_t rings, size_t points) {
+    std::mt19937 rng(4);
+    string json = "{\"type\":\"FeatureCollection\",\"features\":[{\"type\":\"Feature\",\"properties\":"
+                  "{\"name\":\"Canada\"},\"geometry\":{\"type\":\"Polygon\",\"coordinates\":[";
+    for (size_t r = 0; r < rings; ++r) {
+        json += r ? ",[" : "[";
+        for (size_t i = 0; i < points; ++i) {
+            json += i ? ",[" : "[";
+            append_format(json, "%.15g", -141 + (double)(rng() % 1000000000) / 1e7);
+            json += ',';
+            append_format(json, "%.15g", 41 + (double)(rng() % 1000000000) / 2.5e7);
+            json += ']';
+        }
+        json += ']';
+    }
+    json += "]}}]}";
+    return json;
+}
+
+/* like citm_catalog.json: objects keyed by numeric ids, integer arrays, many nulls */
+static string make_citm(size_t events, size_t performances) {
+    std::mt19937 rng(5);
+    string json = "{\"areaNames\":{";
+    for (size_t i = 0; i < 40; ++i)
+        json += (i ? ",\"" : "\"") + std::to_string(205705993 + i) + "\":\"Arri\xc3\xa8re-sc\xc3\xa8ne " +
+                std::to_string(i) + "\"";
+    json += "},\"events\":{";
+    for (size_t i = 0; i < events; ++i) {
+        const string id = std::to_string(138586341 + i * 4);
+        json += (i ? ",\"" : "\"") + id + "\":{\"description\":null,\"id\":" + id +
+                ",\"logo\":\"/images/UE0AAAAACEKo6QAAAAVDSVRN\",\"name\":\"30th Anniversary Tour\","
+                "\"subTopicIds\":[337184269,337184283],\"subjectCode\":null,\"subtitle\":null,"
+                "\"topicIds\":[324846099,107888604]}";
+    }
+    json += "},\"performances\":[";
+    for (size_t i = 0; i < performances; ++i) {
+        json += i ? ",{" : "{";
+        json += "\"eventId\":" + std::to_string(138586341 + rng() % events * 4) +
+                ",\"id\":" + std::to_string(339187235 + i) + ",\"logo\":null,\"name\":null,\"prices\":[";
+        for (size_t k = 0, n = 1 + rng() % 4; k < n; ++k)
+            json += string(k ? "," : "") + "{\"amount\":" + std::to_string(rng() % 100000) +
+                    ",\"audienceSubCategoryId\":337100890,\"seatCategoryId\":" + std::to_string(338937295 + k) + "}";
+        json += "],\"seatCategories\":[";
+        for (size_t k = 0, n = 1 + rng() % 4; k < n; ++k) {
+            json += string(k ? "," : "") + "{\"areas\":[";
+            for (size_t a = 0, m = 1 + rng() % 6; a < m; ++a)
+                json += string(a ? "," : "") + "{\"areaId\":" + std::to_string(205705993 + rng() % 40) +
+                        ",\"blockIds\":[]}";
+            json += "],\"seatCategoryId\":" + std::to_string(338937295 + k) + "}";
+        }
+        json += "],\"seatMapImage\":null,\"start\":" + std::to_string(1372701600000ull + i * 86400000ull) +
+                ",\"venueCode\":\"PLEYEL_PLEYEL\"}";
+    }
+    json += "],\"topicNames\":{\"107888604\":\"Activit\xc3\xa9\",\"324846099\":\"Concert\"}}";
+    return json;
+}
+
+struct Corpus {
+    const char* name;
+    string json;
+};
+
+static std::vector<Corpus> make_corpus() {
+    std::vector<Corpus> c;
+    c.push_back({"records", make_records(20000)});
+    c.push_back({"numbers", make_numbers(100000)});
+    c.push_back({"strings", make_strings(20000)});
+    c.push_back({"nested", make_nested(2000, 200)});
+    c.push_back({"wide", make_wide(40000)});
+    c.push_back({"twitter", make_twitter(1000)});
+    c.push_back({"canada", make_canada(20, 2500)});
+    c.push_back({"citm", make_citm(400, 2500)});
+    return c;
+}
+
+/* ---- measuring and reporting ---- */
+
+enum Format { TEXT, CSV, JSON };
+static Format g_format = TEXT;
+static const char* g_corpus = "records"; /* the document the current rows are about */
+
+struct Sample {
+    double seconds;
+    size_t allocs;
+};
+
+/* the high-water mark in KiB, since the last reset where Linux allows one (clear_refs 5)
+ * and of the whole process elsewhere */
+static size_t peak_rss() {
+#ifdef __linux__
+    if (FILE* f = fopen("/proc/self/status", "r")) {
+        char line[128];
+        size_t kib = 0;
+        while (fgets(line, sizeof(line), f))
+            if (strncmp(line, "VmHWM:", 6) == 0) kib = strtoul(line + 6, nullptr, 10);
+        fclose(f);
+        if (kib) return kib;
+    }
+#endif
+#ifdef _WIN32
+    return 0;
+#else
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+#ifdef __APPLE__
+    return ru.ru_maxrss / 1024; /* bytes there */
+#else
+    return ru.ru_maxrss;
+#endif
+#endif
+}
+
+/* lowers the high-water mark to what is resident now, so each row reports its own peak */
+static void reset_peak_rss() {
+#ifdef __linux__
+    if (FILE* f = fopen("/proc/self/clear_refs", "w")) {
+        fputs("5", f);
+        fclose(f);
+    }
+#endif
+}
+
+template <class Fn>
+static Sample run_threads(unsigned threads, Fn fn) {
+    std::vector<std::thread> pool;
+    pool.reserve(threads);
+    reset_peak_rss();
+    size_t allocs = g_allocs.load();
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned t = 0; t < threads; ++t) pool.emplace_back(fn);
+    for (std::thread& th : pool) th.join();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return {seconds, g_allocs.load() - allocs - threads}; /* less the thread states */
+}
+
+/* one row: bytes of JSON and documents handled over the sample */
+static void report(const char* name, unsigned threads, size_t bytes, size_t docs, const Sample& s) {
+    const double mbps = bytes / s.seconds / 1e6, dps = docs / s.seconds;
+    const double allocs = docs ? (double)s.allocs / docs : 0;
+    const size_t rss = peak_rss();
+    if (g_format == CSV) {
+        cout << g_corpus << ',' << name << ',' << threads << ',' << bytes << ',' << docs << ','
+             << s.seconds << ',' << mbps << ',' << dps << ',' << allocs << ',' << rss << '\n';
+    } else if (g_format == JSON) { /* one object per line */
+        LeptValue row, field;
+        row.init_object();
+        field.set_string(g_corpus);
+        row.pushback_object_member("corpus", field);
+        field.set_string(name);
+        row.pushback_object_member("benchmark", field);
+        const char* keys[] = {"threads", "bytes", "docs", "seconds", "mb_per_s", "docs_per_s", "allocs_per_doc",
+                              "peak_rss_kib"};
+        const double values[] = {(double)threads, (double)bytes, (double)docs, s.seconds, mbps, dps, allocs,
+                                 (double)rss};
+        for (size_t i = 0; i < sizeof(keys) / sizeof(keys[0]); ++i) {
+            field.set_number(values[i]);
+            row.pushback_object_member(keys[i], field);
+        }
+        cout << stringify(row, nullptr) << '\n';
+    } else {
+        cout << std::left << std::setw(9) << g_corpus << std::setw(22) << name << " threads=" << std::setw(3)
+             << threads << std::right << std::fixed << std::setprecision(1) << std::setw(9) << mbps << " MB/s"
+             << std::setw(10) << dps << " docs/s" << std::setw(10) << allocs << " allocs/doc" << std::setw(9)
+             << rss << " KiB peak\n";
+    }
+}
+
+/* free-form lines, only in the text output */
+static void note(const string& s) {
+    if (g_format == TEXT) cout << s << '\n';
+}
+
+/* runs fn for at least kMinSeconds, after one call to warm up and size the batches */
+template <class Fn>
+static void measure(const char* name, size_t bytes, Fn fn) {
+    static const double kMinSeconds = 0.25;
+    const int batch = (int)std::min(1000.0, std::max(1.0, kMinSeconds / 4 / run_threads(1, fn).seconds));
+    Sample total = {0, 0};
+    size_t docs = 0;
+    while (total.seconds < kMinSeconds) {
+        Sample s = run_threads(1, [&]() {
+            for (int i = 0; i < batch; ++i) fn();
+        });
+        total.seconds += s.seconds;
+        total.allocs += s.allocs;
+        docs += batch;
+    }
+    report(name, 1, bytes * docs, docs, total);
+}
+
+/* parse, stringify and a round trip over one document */
+static void bench_corpus(const Corpus& c) {
+    g_corpus = c.name;
+    LeptValue v;
+    if (parse(v, c.json) != PARSE_OK) std::abort();
+    measure("parse", c.json.size(), [&]() {
+        LeptValue w;
+        if (parse(w, c.json) != PARSE_OK) std::abort();
+    });
+    measure("stringify", c.json.size(), [&]() {
+        if (stringify(v, nullptr).empty()) std::abort();
+    });
+    measure("roundtrip", c.json.size(), [&]() {
+        LeptValue w;
+        if (parse(w, c.json) != PARSE_OK || stringify(w, nullptr).empty()) std::abort();
+    });
+}
+
+/* ---- features against each other on the records document ---- */
+
+/* parse + destroy, LeptValue on the heap against Document in an arena */
+static void bench_parse_destroy(const string& json, int iterations, unsigned threads) {
+    size_t bytes = json.size() * iterations * threads, docs = iterations * threads;
+    Sample s = run_threads(threads, [&]() {
+        for (int i = 0; i < iterations; ++i) {
+            LeptValue v;
+            if (parse(v, json) != PARSE_OK) std::abort();
+        }
+    });
+    report("parse+destroy heap", threads, bytes, docs, s);
+    s = run_threads(threads, [&]() {
+        for (int i = 0; i < iterations; ++i) {
+            Document doc;
+            if (doc.parse(json) != PARSE_OK) std::abort();
+        }
+    });
+    report("parse+destroy arena", threads, bytes, docs, s);
+    s = run_threads(threads, [&]() {
+        Document doc; /* keeps its largest block between parses */
+        for (int i = 0; i < iterations; ++i)
+            if (doc.parse(json) != PARSE_OK) std::abort();
+    });
+    report("parse reused arena", threads, bytes, docs, s);
+    s = run_threads(threads, [&]() {
+        KeyPool keys; /* the records repeat the same few keys */
+        Document doc;
+        doc.set_key_pool(&keys);
+        for (int i = 0; i < iterations; ++i)
+            if (doc.parse(json) != PARSE_OK) std::abort();
+    });
+    report("parse interned keys", threads, bytes, docs, s);
+    s = run_threads(threads, [&]() {
+        LeptValue v; /* refilled in place from the second parse on */
+        for (int i = 0; i < iterations; ++i)
+            if (parse_reuse(v, json) != PARSE_OK) std::abort();
+    });
+    report("parse reusing the DOM", threads, bytes, docs, s);
+}
+
+/* stringify into one string against streaming through a fixed buffer */
+static void bench_stringify(const string& json, int iterations) {
+    LeptValue v;
+    if (parse(v, json) != PARSE_OK) std::abort();
+    size_t bytes = 0;
+    Sample s = run_threads(1, [&]() {
+        for (int i = 0; i < iterations; ++i) bytes += stringify(v, nullptr).size();
+    });
+    report("stringify string", 1, bytes, iterations, s);
+    bytes = 0;
+    s = run_threads(1, [&]() {
+        for (int i = 0; i < iterations; ++i) {
+            CallbackWriter w([&](const char*, size_t n) {
+                bytes += n;
+                return true;
+            });
+            stringify(v, w);
+        }
+    });
+    report("stringify 64K buffer", 1, bytes, iterations, s);
+}
+
+/* reading a few fields of a mid-sized document: full DOM against lazy */
+static void bench_lazy(int iterations) {
+    const string json = make_records(450); /* about 50 KB */
+    const size_t picks[] = {3, 200, 449};
+    double sum = 0;
+    Sample s = run_threads(1, [&]() {
+        for (int i = 0; i < iterations; ++i) {
+            LeptValue v;
+            if (parse(v, json) != PARSE_OK) std::abort();
+            for (size_t k : picks) sum += v.get_array_element(k).get_object_value(2).get_number();
+        }
+    });
+    report("3 fields full parse", 1, json.size() * iterations, iterations, s);
+    s = run_threads(1, [&]() {
+        LazyDocument doc;
+        for (int i = 0; i < iterations; ++i) {
+            if (doc.parse(json) != PARSE_OK) std::abort();
+            for (size_t k : picks)
+                sum += doc.get_root().get_array_element(k).get_object_value("score").get_number();
+        }
+    });
+    report("3 fields lazy", 1, json.size() * iterations, iterations, s);
+    if (sum < 0) std::abort();
+}
+
+/* loading a cached document: JSON text against the binary form */
+static void bench_binary(const string& json, int iterations) {
+    LeptValue v;
+    if (parse(v, json) != PARSE_OK) std::abort();
+    const string bin = encode_binary(v);
+    note("binary: " + std::to_string(bin.size() / 1024) + " KiB");
+    Sample s = run_threads(1, [&]() {
+        for (int i = 0; i < iterations; ++i) {
+            LeptValue w;
+            if (parse(w, json) != PARSE_OK) std::abort();
+        }
+    });
+    report("load text", 1, json.size() * iterations, iterations, s);
+    s = run_threads(1, [&]() {
+        for (int i = 0; i < iterations; ++i) {
+            LeptValue w;
+            if (decode_binary(w, bin) != PARSE_OK) std::abort();
+        }
+    });
+    report("load binary", 1, json.size() * iterations, iterations, s); /* per byte of JSON, comparable */
+    s = run_threads(1, [&]() {
+        for (int i = 0; i < iterations; ++i)
+            if (encode_binary(v).empty()) std::abort();
+    });
+    report("save binary", 1, json.size() * iterations, iterations, s);
+}
+
+/* a read-only scan over every record: LeptValue against the flat tape */
+static void bench_tape(const string& json, int iterations) {
+    LeptValue v;
+    Tape tape;
+    if (parse(v, json) != PARSE_OK || tape.parse(json) != PARSE_OK) std::abort();
+    note("tape: " + std::to_string((tape.get_tape_size() * 8 + tape.get_string_buffer_size()) / 1024) + " KiB");
+    double sum = 0;
+    Sample s = run_threads(1, [&]() {
+        for (int i = 0; i < iterations; ++i)
+            for (size_t k = 0; k < v.get_array_size(); ++k)
+                sum += v.get_array_element(k).get_object_value(5).get_object_value(0).get_number();
+    });
+    report("scan LeptValue", 1, json.size() * iterations, iterations, s);
+    s = run_threads(1, [&]() {
+        for (int i = 0; i < iterations; ++i) {
+            TapeValue root = tape.get_root();
+            for (size_t k = 0; k < root.get_array_size(); ++k)
+                sum += root.get_array_element(k).get_object_value(5).get_object_value(0).get_number();
+        }
+    });
+    report("scan tape", 1, json.size() * iterations, iterations, s);
+    s = run_threads(1, [&]() {
+        for (int i = 0; i < iterations; ++i) {
+            Tape tp;
+            if (tp.parse(json) != PARSE_OK) std::abort();
+        }
+    });
+    report("parse tape", 1, json.size() * iterations, iterations, s);
+    s = run_threads(1, [&]() {
+        string buffer;
+        for (int i = 0; i < iterations; ++i) {
+            buffer = json; /* the message buffer the caller would own anyway */
+            Tape tp;
+            if (tp.parse_insitu(&buffer[0], buffer.size()) != PARSE_OK) std::abort();
+        }
+    });
+    report("parse tape in situ", 1, json.size() * iterations, iterations, s);
+    if (sum < 0) std::abort();
+}
+
+struct Pos {
+    double x, y;
+};
+LEPT_BIND(Pos, LEPT_FIELD(x), LEPT_FIELD(y))
+
+/* one element of make_records() */
+struct Record {
+    int64_t id;
+    string name;
+    double score;
+    bool active;
+    vector<string> tags;
+    Pos pos;
+};
+LEPT_BIND(Record, LEPT_FIELD(id), LEPT_FIELD(name), LEPT_FIELD(score), LEPT_FIELD(active), LEPT_FIELD(tags),
+          LEPT_FIELD(pos))
+
+/* filling structs: through a LeptValue by hand against binding them to the parser */
+static void bench_struct(const string& json, int iterations) {
+    double sum = 0;
+    Sample s = run_threads(1, [&]() {
+        for (int i = 0; i < iterations; ++i) {
+            LeptValue v;
+            if (parse(v, json) != PARSE_OK) std::abort();
+            vector<Record> records(v.get_array_size());
+            for (size_t k = 0; k < records.size(); ++k) {
+                const LeptValue& o = v.get_array_element(k);
+                Record& r = records[k];
+                r.id = (int64_t)o.get_object_value("id")->get_number();
+                const LeptValue& name = *o.get_object_value("name");
+                r.name.assign(name.get_string(), name.get_string_length());
+                r.score = o.get_object_value("score")->get_number();
+                r.active = o.get_object_value("active")->get_boolean();
+                const LeptValue& tags = *o.get_object_value("tags");
+                for (size_t t = 0; t < tags.get_array_size(); ++t) {
+                    const LeptValue& tag = tags.get_array_element(t);
+                    r.tags.emplace_back(tag.get_string(), tag.get_string_length());
+                }
+                r.pos.x = o.get_object_value("pos")->get_object_value("x")->get_number();
+                r.pos.y = o.get_object_value("pos")->get_object_value("y")->get_number();
+            }
+            sum += records.back().score;
+        }
+    });
+    report("structs via LeptValue", 1, json.size() * iterations, iterations, s);
+    vector<Record> records;
+    s = run_threads(1, [&]() {
+        for (int i = 0; i < iterations; ++i) {
+            vector<Record> r;
+            if (parse_struct(r, json) != PARSE_OK) std::abort();
+            sum += r.back().score;
+            if (i == 0) records = std::move(r);
+        }
+    });
+    report("parse_struct", 1, json.size() * iterations, iterations, s);
+    size_t bytes = 0;
+    s = run_threads(1, [&]() {
+        for (int i = 0; i < iterations; ++i) bytes += stringify_struct(records).size();
+    });
+    report("stringify_struct", 1, bytes, iterations, s);
+    if (sum < 0) std::abort();
+}
+
+/* one document, its root array split over threads */
+static void bench_parallel(const string& json, int iterations, unsigned threads) {
+    Sample s = run_threads(1, [&]() {
+        for (int i = 0; i < iterations; ++i) {
+            LeptValue v;
+            if (parse_parallel(v, json, threads) != PARSE_OK) std::abort();
+        }
+    });
+    report("parse_parallel", threads, json.size() * iterations, iterations, s);
+}
+
+/* the records of json, one per line */
+static void bench_lines(const string& json, int iterations, unsigned threads) {
+    string lines = json.substr(1, json.size() - 2);
+    for (size_t at = 0; (at = lines.find("},{\"id\"", at)) != string::npos; at += 2) lines[at + 1] = '\n';
+    size_t records = 0;
+    Sample s = run_threads(1, [&]() {
+        for (int i = 0; i < iterations; ++i)
+            parse_lines(lines, [&records](size_t, int ret, const LeptValue&) {
+                if (ret != PARSE_OK) std::abort();
+                ++records;
+                return true;
+            }, threads);
+    });
+    if (records != 20000u * iterations) std::abort();
+    report("parse_lines", threads, lines.size() * iterations, records, s); /* a document per line */
+}
+
+static void bench_features(const string& json, unsigned threads) {
+    g_corpus = "records";
+    bench_parse_destroy(json, 20, 1);
+    bench_stringify(json, 20);
+    bench_lazy(1000);
+    bench_binary(json, 20);
+    bench_tape(json, 20);
+    bench_struct(json, 20);
+    if (threads > 1) bench_parse_destroy(json, 20, threads);
+    bench_parallel(json, 20, 1);
+    if (threads > 1) bench_parallel(json, 20, threads);
+    bench_lines(json, 20, 1);
+    if (threads > 1) bench_lines(json, 20, threads);
+}
+
+}  // namespace lept
+
+static int usage(const char* self) {
+    std::cerr << "usage: " << self << " [threads] [--format=text|csv|json] [--suite=all|corpus|features]"
+              << " [--corpus=name]\n";
+    return 1;
+}
+
+int main(int argc, char* argv[]) {
+    using lept::g_format;
+    unsigned hw = std::thread::hardware_concurrency();
+    unsigned threads = hw ? hw : 1;
+    std::string suite = "all", only;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--format=text") g_format = lept::TEXT;
+        else if (arg == "--format=csv") g_format = lept::CSV;
+        else if (arg == "--format=json") g_format = lept::JSON;
+        else if (arg.compare(0, 8, "--suite=") == 0) suite = arg.substr(8);
+        else if (arg.compare(0, 9, "--corpus=") == 0) only = arg.substr(9);
+        else if (!arg.empty() && isdigit((unsigned char)arg[0])) threads = (unsigned)std::atoi(argv[i]);
+        else return usage(argv[0]);
+    }
+    if (suite != "all" && suite != "corpus" && suite != "features") return usage(argv[0]);
+
+    if (g_format == lept::CSV)
+        std::cout << "corpus,benchmark,threads,bytes,docs,seconds,mb_per_s,docs_per_s,allocs_per_doc,peak_rss_kib\n";
+    std::vector<lept::Corpus> corpus = lept::make_corpus();
+    for (const lept::Corpus& c : corpus)
+        lept::note(std::string(c.name) + ": " + std::to_string(c.json.size() / 1024) + " KiB");
+    if (suite != "features")
+        for (const lept::Corpus& c : corpus)
+            if (only.empty() || only == c.name) lept::bench_corpus(c);
+    if (suite != "corpus") lept::bench_features(corpus[0].json, threads);
+    return 0;
+}
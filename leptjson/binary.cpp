@@ -0,0 +1,216 @@
+#include "binary.h"
+
+#include <cstdint>
+#include <cstring>
+
+#include "internal.h"
+
+namespace lept {
+
+enum { TAG_NULL, TAG_FALSE, TAG_TRUE, TAG_NUMBER, TAG_STRING, TAG_ARRAY, TAG_OBJECT };
+
+static const char kHeader[4] = {'L', 'J', 'B', 1};
+
+static bool little_endian() {
+    const uint16_t one = 1;
+    return *(const unsigned char*)&one == 1;
+}
+
+static void put_varint(Writer& w, uint64_t n) {
+    char buf[10];
+    size_t len = 0;
+    while (n >= 0x80) {
+        buf[len++] = (char)(n | 0x80);
+        n >>= 7;
+    }
+    buf[len++] = (char)n;
+    w.write(buf, len);
+}
+
+static void put_bytes(Writer& w, const char* s, size_t length) {
+    put_varint(w, length);
+    w.write(s, length);
+}
+
+static void put_key(Writer& w, const LeptValue& object, size_t i) {
+    const string& key = object.get_object_key(i);
+    put_bytes(w, key.data(), key.size());
+}
+
+/* iterative like stringify, so a tree of any depth encodes without deep recursion */
+static void encode_value(const LeptValue& v, Writer& w) {
+    FrameStack<> stack;
+    const LeptValue* cur = &v;
+    while (true) {
+        switch (cur->get_type()) {
+            case NONE: w.put(TAG_NULL); break;
+            case FALSE: w.put(TAG_FALSE); break;
+            case TRUE: w.put(TAG_TRUE); break;
+            case NUMBER: {
+                char buf[9];
+                double n = cur->get_number();
+                buf[0] = TAG_NUMBER;
+                memcpy(buf + 1, &n, 8);
+                if (!little_endian())
+                    for (int i = 0; i < 4; ++i) std::swap(buf[1 + i], buf[8 - i]);
+                w.write(buf, 9);
+                break;
+            }
+            case STRING:
+                w.put(TAG_STRING);
+                put_bytes(w, cur->get_string(), cur->get_string_length());
+                break;
+            case ARRAY:
+                w.put(TAG_ARRAY);
+                put_varint(w, cur->get_array_size());
+                if (cur->get_array_size() == 0) break;
+                stack.push(Frame{cur, 0, '['});
+                cur = &cur->get_array_element(0);
+                continue;
+            case OBJECT:
+                w.put(TAG_OBJECT);
+                put_varint(w, cur->get_object_size());
+                if (cur->get_object_size() == 0) break;
+                put_key(w, *cur, 0);
+                stack.push(Frame{cur, 0, '{'});
+                cur = &cur->get_object_value(0);
+                continue;
+            default: throw "Invalid value type";
+        }
+        while (true) { /* cur is written, move to its next sibling */
+            if (stack.empty()) return;
+            Frame& f = stack.top();
+            const LeptValue& parent = *f.value;
+            size_t i = ++f.count;
+            if (f.kind == '[') {
+                if (i < parent.get_array_size()) {
+                    cur = &parent.get_array_element(i);
+                    break;
+                }
+            } else if (i < parent.get_object_size()) {
+                put_key(w, parent, i);
+                cur = &parent.get_object_value(i);
+                break;
+            }
+            stack.pop();
+        }
+    }
+}
+
+bool encode_binary(const LeptValue& v, Writer& w) {
+    w.write(kHeader, 4);
+    encode_value(v, w);
+    return w.flush();
+}
+
+string encode_binary(const LeptValue& v) {
+    string s;
+    {
+        StringWriter w(s);
+        encode_binary(v, w);
+    }
+    return s;
+}
+
+namespace {
+
+struct Decoder {
+    const unsigned char* p;
+    const unsigned char* end;
+    size_t maxDepth;
+    size_t pending; /* bytes still owed to the open containers' elements after the current ones */
+
+    bool varint(uint64_t& n) {
+        n = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            if (this->p == this->end) return false;
+            const unsigned char b = *this->p++;
+            n |= (uint64_t)(b & 0x7F) << shift;
+            if (!(b & 0x80)) return true;
+        }
+        return false;
+    }
+    /* a length that the remaining input can hold next to what the open containers still need,
+     * each item takes at least `unit` bytes. Counts are reserved up front, so a count that is
+     * only checked against the whole input would let nested headers reserve it many times. */
+    bool length(size_t& n, size_t unit) {
+        uint64_t u;
+        if (!this->varint(u)) return false;
+        const size_t left = this->end - this->p;
+        if (left < this->pending || u > (uint64_t)(left - this->pending) / unit) return false;
+        n = (size_t)u;
+        return true;
+    }
+    int value(LeptValue& v, size_t depth);
+};
+
+int Decoder::value(LeptValue& v, size_t depth) {
+    if (this->p == this->end) return PARSE_INVALID_BINARY;
+    size_t n, len;
+    int ret;
+    switch (*this->p++) {
+        case TAG_NULL: return PARSE_OK;
+        case TAG_FALSE: v.set_boolean(false); return PARSE_OK;
+        case TAG_TRUE: v.set_boolean(true); return PARSE_OK;
+        case TAG_NUMBER: {
+            if (this->end - this->p < 8) return PARSE_INVALID_BINARY;
+            unsigned char buf[8];
+            memcpy(buf, this->p, 8);
+            if (!little_endian())
+                for (int i = 0; i < 4; ++i) std::swap(buf[i], buf[7 - i]);
+            double d;
+            memcpy(&d, buf, 8);
+            v.set_number(d);
+            this->p += 8;
+            return PARSE_OK;
+        }
+        case TAG_STRING:
+            if (!this->length(len, 1)) return PARSE_INVALID_BINARY;
+            v.set_string((const char*)this->p, len);
+            this->p += len;
+            return PARSE_OK;
+        case TAG_ARRAY:
+            if (depth >= this->maxDepth) return PARSE_DEPTH_EXCEEDED;
+            if (!this->length(n, 1)) return PARSE_INVALID_BINARY;
+            v.init_array();
+            v.reserve_array(n);
+            this->pending += n;
+            for (size_t i = 0; i < n; ++i) {
+                --this->pending;
+                v.pushback_array_element(LeptValue());
+                if ((ret = this->value(v.get_array_element(i), depth + 1)) != PARSE_OK) return ret;
+            }
+            return PARSE_OK;
+        case TAG_OBJECT:
+            if (depth >= this->maxDepth) return PARSE_DEPTH_EXCEEDED;
+            if (!this->length(n, 2)) return PARSE_INVALID_BINARY;
+            v.init_object();
+            v.reserve_object(n);
+            this->pending += 2 * n;
+            for (size_t i = 0; i < n; ++i) {
+                this->pending -= 2;
+                if (!this->length(len, 1)) return PARSE_INVALID_BINARY;
+                v.pushback_object_member(string((const char*)this->p, len), LeptValue());
+                this->p += len;
+                if ((ret = this->value(v.get_object_value(i), depth + 1)) != PARSE_OK) return ret;
+            }
+            return PARSE_OK;
+        default: return PARSE_INVALID_BINARY;
+    }
+}
+
+}  // namespace
+
+int decode_binary(LeptValue& v, const char* data, size_t length) {
+    v.freeVal();
+    if (length < 4 || memcmp(data, kHeader, 4) != 0) return PARSE_INVALID_BINARY;
+    Decoder d{(const unsigned char*)data + 4, (const unsigned char*)data + length, get_max_depth(), 0};
+    int ret = d.value(v, 0);
+    if (ret == PARSE_OK && d.p != d.end) ret = PARSE_INVALID_BINARY; /* trailing bytes */
+    if (ret != PARSE_OK) v.freeVal();
+    return ret;
+}
+
+int decode_binary(LeptValue& v, const string& data) { return decode_binary(v, data.data(), data.size()); }
+
+}  // namespace lept
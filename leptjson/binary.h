@@ -0,0 +1,30 @@
+#ifndef LEPTJSON_BINARY_H
+#define LEPTJSON_BINARY_H
+
+#include <string>
+
+#include "leptjson.h"
+#include "writer.h"
+
+namespace lept {
+
+/* Binary form of a LeptValue for caches, much faster to load than JSON text.
+ *
+ *   header  "LJB" 0x01
+ *   value   tag byte, then
+ *           0 null, 1 false, 2 true: nothing
+ *           3 number: 8-byte IEEE double, little-endian
+ *           4 string: varint length, bytes
+ *           5 array:  varint count, values
+ *           6 object: varint count, then per member varint key length, key bytes, value
+ *   varint  unsigned LEB128, 7 bits per byte, low bits first
+ */
+bool encode_binary(const LeptValue& v, Writer& w); /* false if the sink failed */
+string encode_binary(const LeptValue& v);
+/* PARSE_OK, PARSE_INVALID_BINARY or PARSE_DEPTH_EXCEEDED, v is NONE after an error */
+int decode_binary(LeptValue& v, const char* data, size_t length);
+int decode_binary(LeptValue& v, const string& data);
+
+}  // namespace lept
+
+#endif /* LEPTJSON_BINARY_H */
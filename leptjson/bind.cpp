@@ -0,0 +1,194 @@
+#include "bind.h"
+
+#include <cstring>
+
+namespace lept {
+
+/* key_hash() without the recursion, for keys read from the input */
+static uint32_t runtime_key_hash(const char* s, size_t n) {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < n; ++i) h = (h ^ (unsigned char)s[i]) * 16777619u;
+    return h;
+}
+
+/* doubles the table until the low hash bits tell all fields apart, up to a limit past which
+ * two fields may share a home slot and lookups probe on */
+FieldTable::FieldTable(const Field* fields, size_t count) : fields(fields), count(count) {
+    size_t size = 1;
+    while (size < count * 2) size <<= 1;
+    for (;; size <<= 1) {
+        this->slots.assign(size, 0);
+        bool perfect = true;
+        for (size_t i = 0; i < count; ++i) {
+            size_t j = fields[i].hash & (size - 1);
+            if (this->slots[j] != 0) {
+                perfect = false;
+                if (size < count * 64) break;
+                while (this->slots[j] != 0) j = (j + 1) & (size - 1);
+            }
+            this->slots[j] = (uint32_t)(i + 1);
+        }
+        if (perfect || size >= count * 64) return;
+    }
+}
+
+const Field* FieldTable::find(const char* key, size_t length) const {
+    const size_t mask = this->slots.size() - 1;
+    for (size_t j = runtime_key_hash(key, length) & mask;; j = (j + 1) & mask) {
+        const uint32_t slot = this->slots[j];
+        if (slot == 0) return nullptr;
+        const Field& f = this->fields[slot - 1];
+        if (f.length == length && memcmp(f.name, key, length) == 0) return &f;
+    }
+}
+
+void write_integer(Writer& w, uint64_t magnitude, bool negative) {
+    char buf[21];
+    char* p = buf + sizeof(buf);
+    do {
+        *--p = (char)('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude);
+    if (negative) *--p = '-';
+    w.write(p, buf + sizeof(buf) - p);
+}
+
+bool read_integer(const char* text, size_t length, uint64_t& magnitude, bool& negative) {
+    const char* p = text;
+    const char* end = text + length;
+    negative = p != end && *p == '-';
+    if (negative) ++p;
+    /* the digits before and after the point make one integer m. Zeros are held back until a
+     * later digit needs them, so trailing ones become part of the scale instead of m. */
+    uint64_t m = 0;
+    size_t zeros = 0;
+    long long scale = 0;
+    bool fraction = false;
+    for (; p != end && *p != 'e' && *p != 'E'; ++p) {
+        if (*p == '.') {
+            fraction = true;
+            continue;
+        }
+        if (fraction) --scale;
+        if (*p == '0') {
+            ++zeros;
+            continue;
+        }
+        for (; zeros && m; --zeros) {
+            if (m > UINT64_MAX / 10) return false;
+            m *= 10;
+        }
+        zeros = 0;
+        const unsigned d = *p - '0';
+        if (m > (UINT64_MAX - d) / 10) return false;
+        m = m * 10 + d;
+    }
+    if (p != end) { /* the exponent, capped where any nonzero m would overflow anyway */
+        ++p;
+        const bool down = *p == '-';
+        if (*p == '+' || *p == '-') ++p;
+        long long e = 0;
+        for (; p != end; ++p)
+            if (e < 1000000) e = e * 10 + (*p - '0');
+        scale += down ? -e : e;
+    }
+    scale += (long long)zeros;
+    if (m != 0) {
+        if (scale < 0) return false; /* m ends in a nonzero digit, a fraction remains */
+        for (; scale > 0; --scale) {
+            if (m > UINT64_MAX / 10) return false;
+            m *= 10;
+        }
+    }
+    magnitude = m;
+    return true;
+}
+
+/* routes the parser's events to the binders of the values being filled */
+class BindHandler : public Handler {
+   public:
+    BindHandler(void* root, const Binder& b) : mismatch(false), skip(0) {
+        this->pending.object = root;
+        this->pending.binder = &b;
+    }
+    bool Null() override {
+        Slot s = this->next();
+        return !s.object || this->check(s.binder->Null(s.object));
+    }
+    bool Bool(bool b) override {
+        Slot s = this->next();
+        return !s.object || this->check(s.binder->Bool(s.object, b));
+    }
+    bool RawNumber(const char* str, size_t len, double n) override {
+        Slot s = this->next();
+        return !s.object || this->check(s.binder->Number(s.object, n, str, len));
+    }
+    bool String(const char* str, size_t len) override {
+        Slot s = this->next();
+        return !s.object || this->check(s.binder->String(s.object, str, len));
+    }
+    bool StartObject() override { return this->open(false); }
+    bool Key(const char* str, size_t len) override {
+        if (this->skip) return true;
+        const Slot& top = this->stack.back();
+        this->pending.object = top.binder->Member(top.object, str, len, this->pending.binder);
+        return true;
+    }
+    bool EndObject(size_t) override { return this->close(); }
+    bool StartArray() override { return this->open(true); }
+    bool EndArray(size_t) override { return this->close(); }
+
+    bool mismatch; /* the parse was stopped by a value of the wrong type */
+
+   private:
+    struct Slot {
+        void* object; /* null for a value that is skipped */
+        const Binder* binder;
+        bool array;
+    };
+
+    /* where the next value goes: a new element, or the field Key found */
+    Slot next() {
+        Slot s = {nullptr, nullptr, false};
+        if (this->skip) return s;
+        if (this->stack.empty() || !this->stack.back().array) return this->pending;
+        const Slot& top = this->stack.back();
+        s.object = top.binder->Element(top.object, s.binder);
+        return s;
+    }
+    bool open(bool array) {
+        Slot s = this->next();
+        if (!s.object) { /* an unbound member, skipped with everything in it */
+            ++this->skip;
+            return true;
+        }
+        if (!this->check(array ? s.binder->StartArray(s.object) : s.binder->StartObject(s.object)))
+            return false;
+        s.array = array;
+        this->stack.push_back(s);
+        return true;
+    }
+    bool close() {
+        if (this->skip)
+            --this->skip;
+        else
+            this->stack.pop_back();
+        return true;
+    }
+    bool check(bool ok) {
+        if (!ok) this->mismatch = true;
+        return ok;
+    }
+
+    Slot pending;      /* the root, then the field of the last key */
+    vector<Slot> stack; /* open arrays and objects being filled */
+    size_t skip;       /* depth inside a skipped value */
+};
+
+int parse_bound(void* object, const Binder& b, const char* json, size_t length) {
+    BindHandler h(object, b);
+    int ret = parse(h, json, length);
+    return ret == PARSE_TERMINATED && h.mismatch ? PARSE_TYPE_MISMATCH : ret;
+}
+
+}  // namespace lept
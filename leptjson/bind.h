@@ -0,0 +1,274 @@
+#ifndef LEPTJSON_BIND_H
+#define LEPTJSON_BIND_H
+
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "leptjson.h"
+#include "writer.h"
+
+namespace lept {
+
+/* Binding of C++ structs to JSON objects, parsed and written without a LeptValue in between:
+ *
+ *   struct Order { int64_t id; string sku; vector<double> prices; Address to; };
+ *   LEPT_BIND(Order, LEPT_FIELD(id), LEPT_FIELD(sku), LEPT_FIELD(prices), LEPT_FIELD(to))
+ *
+ * LEPT_BIND goes in the struct's namespace. Fields may be bool, arithmetic types, string,
+ * vector of a supported type or another bound struct. Members of the JSON object that are not
+ * bound are skipped, fields missing from it or given null keep their value. */
+
+/* converts between JSON and one C++ type, the object is passed untyped. The value callbacks
+ * return false when the JSON value does not fit the type. */
+class Binder {
+   public:
+    virtual ~Binder() {}
+    /* null stands for no value, the object is left as it is */
+    virtual bool Null(void*) const { return true; }
+    virtual bool Bool(void*, bool) const { return false; }
+    /* text is the number as written, n its value as a double */
+    virtual bool Number(void*, double, const char*, size_t) const { return false; }
+    virtual bool String(void*, const char*, size_t) const { return false; }
+    virtual bool StartObject(void*) const { return false; }
+    virtual bool StartArray(void*) const { return false; }
+    /* objects: the field bound to key and its binder, nullptr when there is none */
+    virtual void* Member(void*, const char*, size_t, const Binder*&) const { return nullptr; }
+    /* arrays: appends an element and returns it */
+    virtual void* Element(void*, const Binder*&) const { return nullptr; }
+    virtual void Write(const void* object, Writer& w) const = 0;
+};
+
+/* FNV-1a, evaluated at compile time for the field names */
+constexpr uint32_t key_hash(const char* s, size_t n, uint32_t h = 2166136261u) {
+    return n == 0 ? h : key_hash(s + 1, n - 1, (h ^ (unsigned char)*s) * 16777619u);
+}
+
+/* one field of a bound struct, made by LEPT_FIELD */
+struct Field {
+    const char* name;
+    size_t length;
+    uint32_t hash;
+    void* (*member)(void* object); /* the field inside an object of the struct */
+    const Binder& (*binder)();
+};
+
+/* the fields of a struct with a table over their key hashes, sized so that each field has a
+ * slot of its own and a lookup is one probe and one compare */
+class FieldTable {
+   public:
+    FieldTable(const Field* fields, size_t count);
+    const Field* find(const char* key, size_t length) const;
+    const Field* begin() const { return this->fields; }
+    const Field* end() const { return this->fields + this->count; }
+
+   private:
+    const Field* fields;
+    size_t count;
+    vector<uint32_t> slots; /* position + 1, 0 is empty */
+};
+
+template <class T, class Enable = void>
+class TypeBinder;
+
+template <class T>
+const Binder& binder_of() {
+    static const TypeBinder<T> binder{};
+    return binder;
+}
+
+template <class T, class F, F T::*M>
+void* member_of(void* object) {
+    return &(static_cast<T*>(object)->*M);
+}
+
+template <class T, class F, F T::*M>
+constexpr Field make_field(const char* name, size_t length) {
+    return Field{name, length, key_hash(name, length), &member_of<T, F, M>, &binder_of<F>};
+}
+
+/* bound structs, found through the lept_fields() that LEPT_BIND declares */
+template <class T, class Enable>
+class TypeBinder : public Binder {
+   public:
+    bool StartObject(void*) const override { return true; }
+    void* Member(void* object, const char* key, size_t length, const Binder*& b) const override {
+        const Field* f = fields().find(key, length);
+        if (f == nullptr) return nullptr;
+        b = &f->binder();
+        return f->member(object);
+    }
+    void Write(const void* object, Writer& w) const override;
+
+   private:
+    static const FieldTable& fields() { return lept_fields(static_cast<const T*>(nullptr)); }
+};
+
+template <class T, class Enable>
+void TypeBinder<T, Enable>::Write(const void* object, Writer& w) const {
+    char sep = '{';
+    for (const Field& f : fields()) {
+        w.put(sep);
+        sep = ',';
+        write_string(w, f.name, f.length);
+        w.put(':');
+        f.binder().Write(f.member(const_cast<void*>(object)), w);
+    }
+    if (sep == '{') w.put('{');
+    w.put('}');
+}
+
+template <>
+class TypeBinder<bool> : public Binder {
+   public:
+    bool Bool(void* object, bool b) const override {
+        *static_cast<bool*>(object) = b;
+        return true;
+    }
+    void Write(const void* object, Writer& w) const override {
+        if (*static_cast<const bool*>(object))
+            w.write("true", 4);
+        else
+            w.write("false", 5);
+    }
+};
+
+/* writes an integer exactly, doubles lose precision past 2^53 */
+void write_integer(Writer& w, uint64_t magnitude, bool negative);
+
+/* reads the text of a JSON number as an integer without going through a double, false when it
+ * is not whole or its magnitude does not fit 64 bits. "-0" is a negative zero. */
+bool read_integer(const char* text, size_t length, uint64_t& magnitude, bool& negative);
+
+/* integers only take numbers that are whole and in range, read from their text */
+template <class T>
+class TypeBinder<T, typename std::enable_if<std::is_integral<T>::value && !std::is_same<T, bool>::value>::type>
+    : public Binder {
+   public:
+    bool Number(void* object, double, const char* text, size_t length) const override {
+        uint64_t m;
+        bool negative;
+        if (!read_integer(text, length, m, negative)) return false;
+        if (negative) {
+            if (m > (uint64_t)0 - (uint64_t)(int64_t)std::numeric_limits<T>::min()) return false;
+            /* min is -(max + 1), so m - 1 fits T */
+            *static_cast<T*>(object) = m == 0 ? T(0) : (T)(-(T)(m - 1) - 1);
+        } else {
+            if (m > (uint64_t)std::numeric_limits<T>::max()) return false;
+            *static_cast<T*>(object) = (T)m;
+        }
+        return true;
+    }
+    void Write(const void* object, Writer& w) const override {
+        T t = *static_cast<const T*>(object);
+        if (t < 0)
+            write_integer(w, (uint64_t)0 - (uint64_t)t, true);
+        else
+            write_integer(w, (uint64_t)t, false);
+    }
+};
+
+/* a number beyond the range of a narrower type such as float does not fit it, converting it
+ * would be undefined */
+template <class T>
+class TypeBinder<T, typename std::enable_if<std::is_floating_point<T>::value>::type> : public Binder {
+   public:
+    bool Number(void* object, double n, const char*, size_t) const override {
+        if (sizeof(T) < sizeof(double) &&
+            (n > (double)std::numeric_limits<T>::max() || n < -(double)std::numeric_limits<T>::max()))
+            return false;
+        *static_cast<T*>(object) = (T)n;
+        return true;
+    }
+    void Write(const void* object, Writer& w) const override {
+        write_number(w, (double)*static_cast<const T*>(object));
+    }
+};
+
+template <>
+class TypeBinder<string> : public Binder {
+   public:
+    bool String(void* object, const char* s, size_t length) const override {
+        static_cast<string*>(object)->assign(s, length);
+        return true;
+    }
+    void Write(const void* object, Writer& w) const override {
+        const string& s = *static_cast<const string*>(object);
+        write_string(w, s.data(), s.size());
+    }
+};
+
+/* the array replaces what the vector held */
+template <class T>
+class TypeBinder<vector<T>> : public Binder {
+   public:
+    bool StartArray(void* object) const override {
+        static_cast<vector<T>*>(object)->clear();
+        return true;
+    }
+    void* Element(void* object, const Binder*& b) const override {
+        vector<T>& v = *static_cast<vector<T>*>(object);
+        v.emplace_back();
+        b = &binder_of<T>();
+        return &v.back();
+    }
+    void Write(const void* object, Writer& w) const override {
+        const vector<T>& v = *static_cast<const vector<T>*>(object);
+        const Binder& b = binder_of<T>();
+        w.put('[');
+        for (size_t i = 0; i < v.size(); ++i) {
+            if (i) w.put(',');
+            b.Write(&v[i], w);
+        }
+        w.put(']');
+    }
+};
+
+/* PARSE_TYPE_MISMATCH when a value does not fit its field, the other errors are parse()'s.
+ * After an error object holds whatever was read before it. */
+int parse_bound(void* object, const Binder& b, const char* json, size_t length);
+
+template <class T>
+int parse_struct(T& v, const char* json, size_t length) {
+    return parse_bound(&v, binder_of<T>(), json, length);
+}
+
+template <class T>
+int parse_struct(T& v, const string& strJson) {
+    return parse_struct(v, strJson.data(), strJson.size());
+}
+
+/* streams v to w and flushes it, false if the sink failed */
+template <class T>
+bool stringify_struct(const T& v, Writer& w) {
+    binder_of<T>().Write(&v, w);
+    return w.flush();
+}
+
+template <class T>
+string stringify_struct(const T& v) {
+    string s;
+    {
+        StringWriter w(s);
+        binder_of<T>().Write(&v, w);
+    }
+    return s;
+}
+
+}  // namespace lept
+
+#define LEPT_BIND(Type, ...)                                                                 \
+    inline const ::lept::FieldTable& lept_fields(const Type*) {                              \
+        typedef Type BoundType;                                                              \
+        static constexpr ::lept::Field fields[] = {__VA_ARGS__};                             \
+        static const ::lept::FieldTable table(fields, sizeof(fields) / sizeof(fields[0]));   \
+        return table;                                                                        \
+    }
+
+#define LEPT_FIELD(name)                                                                     \
+    ::lept::make_field<BoundType, decltype(BoundType::name), &BoundType::name>(#name,         \
+                                                                               sizeof(#name) - 1)
+
+#endif /* LEPTJSON_BIND_H */
@@ -0,0 +1,335 @@
+// Grisu2 (Florian Loitsch, "Printing Floating-Point Numbers Quickly and Accurately with
+// Integers", PLDI 2010), following the layout of Milo Yip's implementation in RapidJSON.
+#include "dtoa.h"
+
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+namespace lept {
+
+namespace {
+
+struct DiyFp {
+    DiyFp(uint64_t fp, int exp) : f(fp), e(exp) {}
+
+    explicit DiyFp(double d) {
+        uint64_t u;
+        memcpy(&u, &d, sizeof(u));
+        int biased_e = static_cast<int>((u & kDpExponentMask) >> kDpSignificandSize);
+        uint64_t significand = u & kDpSignificandMask;
+        if (biased_e != 0) {
+            f = significand + kDpHiddenBit;
+            e = biased_e - kDpExponentBias;
+        } else { /* subnormal */
+            f = significand;
+            e = kDpMinExponent + 1;
+        }
+    }
+
+    DiyFp operator-(const DiyFp& rhs) const { return DiyFp(f - rhs.f, e); }
+
+    /* upper 64 bits of the 128-bit product, rounded */
+    DiyFp operator*(const DiyFp& rhs) const {
+        const uint64_t M32 = 0xFFFFFFFF;
+        const uint64_t a = f >> 32;
+        const uint64_t b = f & M32;
+        const uint64_t c = rhs.f >> 32;
+        const uint64_t d = rhs.f & M32;
+        const uint64_t ac = a * c;
+        const uint64_t bc = b * c;
+        const uint64_t ad = a * d;
+        const uint64_t bd = b * d;
+        uint64_t tmp = (bd >> 32) + (ad & M32) + (bc & M32);
+        tmp += 1U << 31;
+        return DiyFp(ac + (ad >> 32) + (bc >> 32) + (tmp >> 32), e + rhs.e + 64);
+    }
+
+    DiyFp Normalize() const {
+        DiyFp res = *this;
+        while (!(res.f & (static_cast<uint64_t>(1) << 63))) {
+            res.f <<= 1;
+            res.e--;
+        }
+        return res;
+    }
+
+    DiyFp NormalizeBoundary() const {
+        DiyFp res = *this;
+        while (!(res.f & (kDpHiddenBit << 1))) {
+            res.f <<= 1;
+            res.e--;
+        }
+        res.f <<= (kDiySignificandSize - kDpSignificandSize - 2);
+        res.e = res.e - (kDiySignificandSize - kDpSignificandSize - 2);
+        return res;
+    }
+
+    /* m-, m+: the halfway points to the neighbouring doubles, with a common exponent */
+    void NormalizedBoundaries(DiyFp* minus, DiyFp* plus) const {
+        DiyFp pl = DiyFp((f << 1) + 1, e - 1).NormalizeBoundary();
+        DiyFp mi = (f == kDpHiddenBit) ? DiyFp((f << 2) - 1, e - 2) : DiyFp((f << 1) - 1, e - 1);
+        mi.f <<= mi.e - pl.e;
+        mi.e = pl.e;
+        *plus = pl;
+        *minus = mi;
+    }
+
+    static const int kDiySignificandSize = 64;
+    static const int kDpSignificandSize = 52;
+    static const int kDpExponentBias = 0x3FF + kDpSignificandSize;
+    static const int kDpMinExponent = -kDpExponentBias;
+    static const uint64_t kDpExponentMask = 0x7FF0000000000000ULL;
+    static const uint64_t kDpSignificandMask = 0x000FFFFFFFFFFFFFULL;
+    static const uint64_t kDpHiddenBit = 0x0010000000000000ULL;
+
+    uint64_t f;
+    int e;
+};
+
+/* normalized 10^k for k = -348, -340, ..., 340 */
+DiyFp GetCachedPowerByIndex(unsigned index) {
+    static const uint64_t kCachedPowers_F[] = {
+        0xfa8fd5a0081c0288, 0xbaaee17fa23ebf76, 0x8b16fb203055ac76,
+        0xcf42894a5dce35ea, 0x9a6bb0aa55653b2d, 0xe61acf033d1a45df,
+        0xab70fe17c79ac6ca, 0xff77b1fcbebcdc4f, 0xbe5691ef416bd60c,
+        0x8dd01fad907ffc3c, 0xd3515c2831559a83, 0x9d71ac8fada6c9b5,
+        0xea9c227723ee8bcb, 0xaecc49914078536d, 0x823c12795db6ce57,
+        0xc21094364dfb5637, 0x9096ea6f3848984f, 0xd77485cb25823ac7,
+        0xa086cfcd97bf97f4, 0xef340a98172aace5, 0xb23867fb2a35b28e,
+        0x84c8d4dfd2c63f3b, 0xc5dd44271ad3cdba, 0x936b9fcebb25c996,
+        0xdbac6c247d62a584, 0xa3ab66580d5fdaf6, 0xf3e2f893dec3f126,
+        0xb5b5ada8aaff80b8, 0x87625f056c7c4a8b, 0xc9bcff6034c13053,
+        0x964e858c91ba2655, 0xdff9772470297ebd, 0xa6dfbd9fb8e5b88f,
+        0xf8a95fcf88747d94, 0xb94470938fa89bcf, 0x8a08f0f8bf0f156b,
+        0xcdb02555653131b6, 0x993fe2c6d07b7fac, 0xe45c10c42a2b3b06,
+        0xaa242499697392d3, 0xfd87b5f28300ca0e, 0xbce5086492111aeb,
+        0x8cbccc096f5088cc, 0xd1b71758e219652c, 0x9c40000000000000,
+        0xe8d4a51000000000, 0xad78ebc5ac620000, 0x813f3978f8940984,
+        0xc097ce7bc90715b3, 0x8f7e32ce7bea5c70, 0xd5d238a4abe98068,
+        0x9f4f2726179a2245, 0xed63a231d4c4fb27, 0xb0de65388cc8ada8,
+        0x83c7088e1aab65db, 0xc45d1df942711d9a, 0x924d692ca61be758,
+        0xda01ee641a708dea, 0xa26da3999aef774a, 0xf209787bb47d6b85,
+        0xb454e4a179dd1877, 0x865b86925b9bc5c2, 0xc83553c5c8965d3d,
+        0x952ab45cfa97a0b3, 0xde469fbd99a05fe3, 0xa59bc234db398c25,
+        0xf6c69a72a3989f5c, 0xb7dcbf5354e9bece, 0x88fcf317f22241e2,
+        0xcc20ce9bd35c78a5, 0x98165af37b2153df, 0xe2a0b5dc971f303a,
+        0xa8d9d1535ce3b396, 0xfb9b7cd9a4a7443c, 0xbb764c4ca7a44410,
+        0x8bab8eefb6409c1a, 0xd01fef10a657842c, 0x9b10a4e5e9913129,
+        0xe7109bfba19c0c9d, 0xac2820d9623bf429, 0x80444b5e7aa7cf85,
+        0xbf21e44003acdd2d, 0x8e679c2f5e44ff8f, 0xd433179d9c8cb841,
+        0x9e19db92b4e31ba9, 0xeb96bf6ebadf77d9, 0xaf87023b9bf0ee6b,
+    };
+    static const int16_t kCachedPowers_E[] = {
+        -1220, -1193, -1166, -1140, -1113, -1087, -1060, -1034, -1007, -980,
+        -954, -927, -901, -874, -847, -821, -794, -768, -741, -715,
+        -688, -661, -635, -608, -582, -555, -529, -502, -475, -449,
+        -422, -396, -369, -343, -316, -289, -263, -236, -210, -183,
+        -157, -130, -103, -77, -50, -24, 3, 30, 56, 83,
+        109, 136, 162, 189, 216, 242, 269, 295, 322, 348,
+        375, 402, 428, 455, 481, 508, 534, 561, 588, 614,
+        641, 667, 694, 720, 747, 774, 800, 827, 853, 880,
+        907, 933, 960, 986, 1013, 1039, 1066,
+    };
+    assert(index < sizeof(kCachedPowers_E) / sizeof(kCachedPowers_E[0]));
+    return DiyFp(kCachedPowers_F[index], kCachedPowers_E[index]);
+}
+
+/* picks c_mk so that the product with a 64-bit significand of exponent e lands in [-60, -32] */
+DiyFp GetCachedPower(int e, int* K) {
+    double dk = (-61 - e) * 0.30102999566398114 + 347;  // dk must be positive, so can do ceiling in positive
+    int k = static_cast<int>(dk);
+    if (dk - k > 0.0) k++;
+    unsigned index = static_cast<unsigned>((k >> 3) + 1);
+    *K = -(-348 + static_cast<int>(index << 3));  // decimal exponent, no lookup table needed
+    return GetCachedPowerByIndex(index);
+}
+
+const uint64_t kPow10[] = {1ULL,
+                           10ULL,
+                           100ULL,
+                           1000ULL,
+                           10000ULL,
+                           100000ULL,
+                           1000000ULL,
+                           10000000ULL,
+                           100000000ULL,
+                           1000000000ULL,
+                           10000000000ULL,
+                           100000000000ULL,
+                           1000000000000ULL,
+                           10000000000000ULL,
+                           100000000000000ULL,
+                           1000000000000000ULL,
+                           10000000000000000ULL,
+                           100000000000000000ULL,
+                           1000000000000000000ULL,
+                           10000000000000000000ULL};
+
+/* moves the last digit towards w while it stays inside the safe interval */
+void GrisuRound(char* buffer, int len, uint64_t delta, uint64_t rest, uint64_t ten_kappa,
+                uint64_t wp_w) {
+    while (rest < wp_w && delta - rest >= ten_kappa &&
+           (rest + ten_kappa < wp_w || wp_w - rest > rest + ten_kappa - wp_w)) {
+        buffer[len - 1]--;
+        rest += ten_kappa;
+    }
+}
+
+int CountDecimalDigit32(uint32_t n) {
+    if (n < 10) return 1;
+    if (n < 100) return 2;
+    if (n < 1000) return 3;
+    if (n < 10000) return 4;
+    if (n < 100000) return 5;
+    if (n < 1000000) return 6;
+    if (n < 10000000) return 7;
+    if (n < 100000000) return 8;
+    return 9; /* p1 has at most 32 bits and the caller keeps it below 10^9 */
+}
+
+void DigitGen(const DiyFp& W, const DiyFp& Mp, uint64_t delta, char* buffer, int* len, int* K) {
+    const DiyFp one(static_cast<uint64_t>(1) << -Mp.e, Mp.e);
+    const DiyFp wp_w = Mp - W;
+    uint32_t p1 = static_cast<uint32_t>(Mp.f >> -one.e);
+    uint64_t p2 = Mp.f & (one.f - 1);
+    int kappa = CountDecimalDigit32(p1);  // kappa in [0, 9]
+    *len = 0;
+
+    while (kappa > 0) {
+        uint32_t d = 0;
+        switch (kappa) {
+            case 9: d = p1 / 100000000; p1 %= 100000000; break;
+            case 8: d = p1 / 10000000; p1 %= 10000000; break;
+            case 7: d = p1 / 1000000; p1 %= 1000000; break;
+            case 6: d = p1 / 100000; p1 %= 100000; break;
+            case 5: d = p1 / 10000; p1 %= 10000; break;
+            case 4: d = p1 / 1000; p1 %= 1000; break;
+            case 3: d = p1 / 100; p1 %= 100; break;
+            case 2: d = p1 / 10; p1 %= 10; break;
+            case 1: d = p1; p1 = 0; break;
+            default: break;
+        }
+        if (d || *len) buffer[(*len)++] = static_cast<char>('0' + d);
+        kappa--;
+        uint64_t tmp = (static_cast<uint64_t>(p1) << -one.e) + p2;
+        if (tmp <= delta) {
+            *K += kappa;
+            GrisuRound(buffer, *len, delta, tmp, kPow10[kappa] << -one.e, wp_w.f);
+            return;
+        }
+    }
+
+    for (;;) { /* kappa <= 0 */
+        p2 *= 10;
+        delta *= 10;
+        char d = static_cast<char>(p2 >> -one.e);
+        if (d || *len) buffer[(*len)++] = static_cast<char>('0' + d);
+        p2 &= one.f - 1;
+        kappa--;
+        if (p2 < delta) {
+            *K += kappa;
+            int index = -kappa;
+            GrisuRound(buffer, *len, delta, p2, one.f, wp_w.f * (index < 20 ? kPow10[index] : 0));
+            return;
+        }
+    }
+}
+
+/* value > 0: buffer[0, length) * 10^K is the shortest (almost always) round-trip decimal */
+void Grisu2(double value, char* buffer, int* length, int* K) {
+    const DiyFp v(value);
+    DiyFp w_m(0, 0), w_p(0, 0);
+    v.NormalizedBoundaries(&w_m, &w_p);
+
+    const DiyFp c_mk = GetCachedPower(w_p.e, K);
+    const DiyFp W = v.Normalize() * c_mk;
+    DiyFp Wp = w_p * c_mk;
+    DiyFp Wm = w_m * c_mk;
+    Wm.f++;
+    Wp.f--;
+    DigitGen(W, Wp, Wp.f - Wm.f, buffer, length, K);
+}
+
+char* write_exponent(int K, char* buffer) {
+    *buffer++ = K < 0 ? '-' : '+';
+    if (K < 0) K = -K;
+    if (K >= 100) {
+        *buffer++ = static_cast<char>('0' + K / 100);
+        K %= 100;
+        *buffer++ = static_cast<char>('0' + K / 10);
+    } else if (K >= 10) {
+        *buffer++ = static_cast<char>('0' + K / 10);
+    }
+    *buffer++ = static_cast<char>('0' + K % 10);
+    return buffer;
+}
+
+/* same notation choice as printf("%.17g"): fixed for -4 <= exponent < 17, otherwise 1.5e+20 */
+char* prettify(char* buffer, int length, int k) {
+    const int kk = length + k; /* 10^(kk-1) <= v < 10^kk */
+    if (k >= 0 && kk <= 17) { /* 1234e7 -> 12340000000 */
+        memset(buffer + length, '0', k);
+        return buffer + kk;
+    } else if (0 < kk && kk <= 17) { /* 1234e-2 -> 12.34 */
+        memmove(buffer + kk + 1, buffer + kk, length - kk);
+        buffer[kk] = '.';
+        return buffer + length + 1;
+    } else if (-4 < kk && kk <= 0) { /* 1234e-6 -> 0.001234 */
+        const int offset = 2 - kk;
+        memmove(buffer + offset, buffer, length);
+        buffer[0] = '0';
+        buffer[1] = '.';
+        memset(buffer + 2, '0', offset - 2);
+        return buffer + length + offset;
+    } else if (length == 1) { /* 1e30 -> 1e+30 */
+        buffer[1] = 'e';
+        return write_exponent(kk - 1, buffer + 2);
+    } else { /* 1234e30 -> 1.234e+33 */
+        memmove(buffer + 2, buffer + 1, length - 1);
+        buffer[1] = '.';
+        buffer[length + 1] = 'e';
+        return write_exponent(kk - 1, buffer + length + 2);
+    }
+}
+
+char* u64toa(uint64_t u, char* buffer) {
+    char tmp[20];
+    int n = 0;
+    do {
+        tmp[n++] = static_cast<char>('0' + u % 10);
+        u /= 10;
+    } while (u);
+    while (n) *buffer++ = tmp[--n];
+    return buffer;
+}
+
+}  // namespace
+
+char* dtoa(double value, char* buffer) {
+    if (std::isnan(value)) {
+        memcpy(buffer, "nan", 3);
+        return buffer + 3;
+    }
+    if (std::signbit(value)) {
+        *buffer++ = '-';
+        value = -value;
+    }
+    if (std::isinf(value)) {
+        memcpy(buffer, "inf", 3);
+        return buffer + 3;
+    }
+    if (value == 0.0) {
+        *buffer++ = '0';
+        return buffer;
+    }
+    /* integers below 2^53 are exact, print them without Grisu */
+    if (value < 9007199254740992.0 && value == static_cast<double>(static_cast<uint64_t>(value)))
+        return u64toa(static_cast<uint64_t>(value), buffer);
+    int length, K;
+    Grisu2(value, buffer, &length, &K);
+    return prettify(buffer, length, K);
+}
+
+}  // namespace lept
@@ -0,0 +1,12 @@
+#ifndef LEPTJSON_DTOA_H
+#define LEPTJSON_DTOA_H
+
+namespace lept {
+
+/* writes the shortest decimal that parses back to exactly value, returns one past the last char.
+ * buffer needs room for 25 chars, no NUL terminator is written. */
+char* dtoa(double value, char* buffer);
+
+}  // namespace lept
+
+#endif /* LEPTJSON_DTOA_H */
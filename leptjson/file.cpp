@@ -0,0 +1,103 @@
+#include <cstdio>
+#include <vector>
+
+#include "leptjson.h"
+
+#ifdef _WIN32
+#define LEPT_HAVE_MMAP 0
+#else
+#define LEPT_HAVE_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace lept {
+
+namespace {
+
+/* the whole file as one read-only range, mapped where mmap exists and read otherwise */
+class FileView {
+   public:
+    FileView() : ptr(nullptr), size(0), mapped(false) {}
+    ~FileView() {
+#if LEPT_HAVE_MMAP
+        if (this->mapped) munmap((void*)this->ptr, this->size);
+#endif
+    }
+    FileView(const FileView&) = delete;
+    FileView& operator=(const FileView&) = delete;
+
+    bool open(const char* path) {
+#if LEPT_HAVE_MMAP
+        int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+        if (fd < 0) return false;
+        struct stat st;
+        if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+            ::close(fd);
+            return false;
+        }
+        this->size = (size_t)st.st_size;
+        if (this->size == 0) { /* mmap rejects empty ranges */
+            ::close(fd);
+            return true;
+        }
+        void* p = mmap(nullptr, this->size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd); /* the mapping keeps the file alive */
+        if (p == MAP_FAILED) return false;
+        madvise(p, this->size, MADV_SEQUENTIAL);
+        this->ptr = (const char*)p;
+        this->mapped = true;
+        return true;
+#else
+        FILE* fp = fopen(path, "rb");
+        if (fp == nullptr) return false;
+        char chunk[64 * 1024];
+        size_t n;
+        while ((n = fread(chunk, 1, sizeof(chunk), fp)) > 0) this->buf.insert(this->buf.end(), chunk, chunk + n);
+        bool ok = !ferror(fp);
+        fclose(fp);
+        this->ptr = this->buf.data();
+        this->size = this->buf.size();
+        return ok;
+#endif
+    }
+    const char* data() const { return this->ptr; }
+    size_t length() const { return this->size; }
+
+   private:
+    const char* ptr;
+    size_t size;
+    bool mapped;
+    std::vector<char> buf;
+};
+
+}  // namespace
+
+int parse_file(LeptValue& v, const char* path) {
+    FileView f;
+    if (!f.open(path)) {
+        v.freeVal();
+        return PARSE_FILE_ERROR;
+    }
+    return parse(v, f.data(), f.length());
+}
+
+int parse_file(Handler& h, const char* path) {
+    FileView f;
+    if (!f.open(path)) return PARSE_FILE_ERROR;
+    return parse(h, f.data(), f.length());
+}
+
+int Document::parse_file(const char* path) {
+    FileView f;
+    if (!f.open(path)) {
+        this->root.freeVal();
+        this->arena.reset();
+        return PARSE_FILE_ERROR;
+    }
+    return this->parse(f.data(), f.length());
+}
+
+}  // namespace lept
@@ -0,0 +1,127 @@
+#ifndef LEPTJSON_INTERNAL_H
+#define LEPTJSON_INTERNAL_H
+
+/* shared by the library's translation units, not part of the public interface */
+
+#include <string>
+#include <vector>
+
+#include "leptjson.h"
+
+namespace lept {
+
+/* validates and converts the number at json, stop is set to the first byte after it */
+int parse_number_span(const char* json, const char* end, double& n, const char*& stop);
+
+/* appends code point u as UTF-8 */
+void encode_utf8(string& s, unsigned u);
+
+/* parse() with the arrays and objects taken from arena, which must outlive v */
+int parse_in_arena(LeptValue& v, const char* json, size_t length, Arena* arena);
+
+/* parse() for text found `depth` containers deep, so the depth limit counts them */
+int parse_nested(LeptValue& v, const char* json, size_t length, size_t depth);
+
+/* one open array or object, for the iterative parser, stringify and the binary encoder */
+struct Frame {
+    const LeptValue* value; /* writers: the container being written */
+    size_t count;           /* values finished so far */
+    char kind;              /* '[' or '{' */
+};
+
+/* Frames live in one buffer per thread and frame type that is kept between calls, so nesting
+ * costs neither call frames nor allocations. A nested call (a Handler that parses again) pushes
+ * above the caller's frames, and the guard pops back to where it started. */
+template <class T = Frame>
+class FrameStack {
+   public:
+    FrameStack() : frames(buffer()), base(frames.size()) {}
+    ~FrameStack() { this->frames.resize(this->base); }
+    size_t depth() const { return this->frames.size() - this->base; }
+    bool empty() const { return this->frames.size() == this->base; }
+    T& top() { return this->frames.back(); }
+    void push(const T& f) { this->frames.push_back(f); }
+    void pop() { this->frames.pop_back(); }
+
+   private:
+    static vector<T>& buffer() {
+        static thread_local vector<T> frames;
+        return frames;
+    }
+    vector<T>& frames;
+    size_t base;
+};
+
+/* builds the DOM from the SAX events, children are constructed in place in their parent */
+class ValueBuilder {
+   public:
+    ValueBuilder(LeptValue& v, Arena* a, KeyPool* k = nullptr, bool views = false)
+        : root(v), arena(a), keys(k), views(views) {}
+    bool Null() {
+        this->add();
+        return true;
+    }
+    bool Bool(bool b) {
+        this->add().set_boolean(b);
+        return true;
+    }
+    bool Number(double n) {
+        this->add().set_number(n);
+        return true;
+    }
+    bool String(const char* s, size_t len) {
+        if (this->views)
+            this->add().set_string_view(s, len);
+        else
+            this->add().set_string(s, len, this->arena);
+        return true;
+    }
+    bool StartObject() {
+        LeptValue& v = this->add();
+        v.init_object(this->arena, this->keys);
+        this->stack.push_back(&v);
+        return true;
+    }
+    bool Key(const char* s, size_t len) {
+        this->key.assign(s, len);
+        return true;
+    }
+    bool EndObject(size_t) {
+        this->stack.pop_back();
+        return true;
+    }
+    bool StartArray() {
+        LeptValue& v = this->add();
+        v.init_array(this->arena);
+        this->stack.push_back(&v);
+        return true;
+    }
+    bool EndArray(size_t) {
+        this->stack.pop_back();
+        return true;
+    }
+
+   private:
+    /* the slot for the next value: the root, a new element or a new member */
+    LeptValue& add() {
+        if (this->stack.empty()) return this->root;
+        LeptValue& top = *this->stack.back();
+        if (top.get_type() == ARRAY) {
+            top.pushback_array_element(LeptValue());
+            return top.get_array_element(top.get_array_size() - 1);
+        }
+        top.pushback_object_member(std::move(this->key), LeptValue());
+        return top.get_object_value(top.get_object_size() - 1);
+    }
+
+    LeptValue& root;
+    Arena* arena;
+    KeyPool* keys;            /* where object keys are interned, if anywhere */
+    bool views;               /* strings refer to the parsed text, which stays valid */
+    vector<LeptValue*> stack; /* open arrays and objects */
+    string key;               /* key of the member whose value comes next */
+};
+
+}  // namespace lept
+
+#endif /* LEPTJSON_INTERNAL_H */
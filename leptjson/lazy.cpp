@@ -0,0 +1,328 @@
+#include "lazy.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+#include "internal.h"
+#include "scan.h"
+
+namespace lept {
+
+static const size_t kNoChildren = (size_t)-1;
+
+/* the input has been validated, so the helpers below only skip and never check */
+static const char* skip_whitespace(const char* p) {
+    while (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r') ++p;
+    return p;
+}
+
+/* p at the opening quote, returns one past the closing quote */
+static const char* skip_string(const char* p, const char* end) {
+    ++p;
+    while (true) {
+        p = skip_plain_chars(p, end);
+        if (*p == '"') return p + 1;
+        p += 2; /* an escape, \uXXXX continues with plain chars */
+    }
+}
+
+namespace {
+
+/* The lazy parse's one pass over the input: follows the grammar byte by byte and records where
+ * each array and object begins and ends, but decodes no string and converts no number. */
+class StructureScanner {
+   public:
+    StructureScanner(const char* json, size_t length, vector<LazySpan>& spans)
+        : p(json), base(json), end(json + length), spans(spans) {}
+    bool scan();
+
+   private:
+    static bool digit(char ch) { return ch >= '0' && ch <= '9'; }
+    static bool hex(char ch) { return digit(ch) || (ch >= 'a' && ch <= 'f') || (ch >= 'A' && ch <= 'F'); }
+    void whitespace() {
+        while (this->p != this->end && (*this->p == ' ' || *this->p == '\t' || *this->p == '\n' || *this->p == '\r'))
+            ++this->p;
+    }
+    bool digits() {
+        if (this->p == this->end || !digit(*this->p)) return false;
+        while (this->p != this->end && digit(*this->p)) ++this->p;
+        return true;
+    }
+    bool literal(const char* text, size_t len) {
+        if ((size_t)(this->end - this->p) < len || memcmp(this->p, text, len) != 0) return false;
+        this->p += len;
+        return true;
+    }
+    bool string();
+    bool number();
+    bool key();
+
+    const char* p;
+    const char* base;
+    const char* end;
+    vector<LazySpan>& spans;
+};
+
+/* the escapes are checked for shape only, surrogate pairs when the string is decoded */
+bool StructureScanner::string() {
+    ++this->p;
+    while (true) {
+        this->p = skip_plain_chars(this->p, this->end);
+        if (this->p == this->end || *this->p == '"') break;
+        if (*this->p != '\\' || ++this->p == this->end) return false; /* a control char */
+        switch (*this->p++) {
+            case '"': case '\\': case '/': case 'b': case 'f': case 'n': case 'r': case 't': break;
+            case 'u':
+                for (int i = 0; i < 4; ++i, ++this->p)
+                    if (this->p == this->end || !hex(*this->p)) return false;
+                break;
+            default: return false;
+        }
+    }
+    return this->p++ != this->end;
+}
+
+/* the grammar of a number, its range is checked when it is read */
+bool StructureScanner::number() {
+    if (this->p != this->end && *this->p == '-') ++this->p;
+    if (this->p != this->end && *this->p == '0')
+        ++this->p;
+    else if (!this->digits())
+        return false;
+    if (this->p != this->end && *this->p == '.' && (++this->p, !this->digits())) return false;
+    if (this->p != this->end && (*this->p == 'e' || *this->p == 'E')) {
+        ++this->p;
+        if (this->p != this->end && (*this->p == '+' || *this->p == '-')) ++this->p;
+        if (!this->digits()) return false;
+    }
+    return true;
+}
+
+/* a member key and the colon after it, up to the value */
+bool StructureScanner::key() {
+    if (this->p == this->end || *this->p != '"' || !this->string()) return false;
+    this->whitespace();
+    if (this->p == this->end || *this->p != ':') return false;
+    ++this->p;
+    this->whitespace();
+    return true;
+}
+
+/* iterative like parse_value, the open containers are indexes into spans */
+bool StructureScanner::scan() {
+    FrameStack<size_t> open;
+    const size_t maxDepth = get_max_depth();
+    this->spans.clear();
+    this->whitespace();
+    while (true) {
+        if (this->p == this->end) return false;
+        switch (*this->p) {
+            case '"':
+                if (!this->string()) return false;
+                break;
+            case 't':
+                if (!this->literal("true", 4)) return false;
+                break;
+            case 'f':
+                if (!this->literal("false", 5)) return false;
+                break;
+            case 'n':
+                if (!this->literal("null", 4)) return false;
+                break;
+            case '[':
+            case '{': {
+                if (open.depth() >= maxDepth) return false;
+                const char close = *this->p == '[' ? ']' : '}';
+                open.push(this->spans.size());
+                this->spans.push_back(LazySpan{(size_t)(this->p - this->base), 0, 0, kNoChildren});
+                ++this->p;
+                this->whitespace();
+                if (this->p != this->end && *this->p == close) {
+                    this->spans[open.top()].end = ++this->p - this->base;
+                    open.pop();
+                    break;
+                }
+                if (close == '}' && !this->key()) return false;
+                continue;
+            }
+            default:
+                if (!this->number()) return false;
+                break;
+        }
+        while (true) { /* a value is done, a comma starts the next one and a bracket closes */
+            this->whitespace();
+            if (open.empty()) return this->p == this->end;
+            if (this->p == this->end) return false;
+            LazySpan& s = this->spans[open.top()];
+            ++s.count;
+            const bool object = this->base[s.begin] == '{';
+            if (*this->p == ',') {
+                ++this->p;
+                this->whitespace();
+                if (object && !this->key()) return false;
+                break;
+            }
+            if (*this->p != (object ? '}' : ']')) return false;
+            s.end = ++this->p - this->base;
+            open.pop();
+        }
+    }
+}
+
+}  // namespace
+
+int LazyDocument::parse(const char* json, size_t length) {
+    this->json = json;
+    this->length = length;
+    this->children.clear();
+    StructureScanner scanner(json, length, this->spans);
+    int ret = PARSE_OK;
+    if (!scanner.scan()) { /* the full parser says what is wrong */
+        Handler h;
+        ret = lept::parse(h, json, length);
+        if (ret == PARSE_OK) ret = PARSE_INVALID_VALUE; /* never expected, the spans are incomplete */
+    }
+    this->ok = ret == PARSE_OK;
+    if (this->ok) {
+        const char* p = json;
+        while (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r') ++p;
+        this->root = p - json;
+    } else {
+        this->spans.clear();
+    }
+    return ret;
+}
+
+LazyValue LazyDocument::get_root() const {
+    return this->ok ? LazyValue(this, this->root) : LazyValue();
+}
+
+const LazySpan& LazyDocument::span_at(size_t pos) const {
+    auto it = std::lower_bound(this->spans.begin(), this->spans.end(), pos,
+                               [](const LazySpan& s, size_t p) { return s.begin < p; });
+    assert(it != this->spans.end() && it->begin == pos);
+    return *it;
+}
+
+const char* LazyDocument::skip_value(const char* p) const {
+    switch (*p) {
+        case '"': return skip_string(p, this->json + this->length);
+        case '[':
+        case '{': return this->json + this->span_at(p - this->json).end;
+        default: /* number or literal */
+            while (p != this->json + this->length && *p != ',' && *p != ']' && *p != '}' &&
+                   *p != ' ' && *p != '\t' && *p != '\n' && *p != '\r')
+                ++p;
+            return p;
+    }
+}
+
+/* offsets of the elements, or of each key followed by its value, found on first use */
+const size_t* LazyDocument::children_of(const LazySpan& s) const {
+    if (s.children == kNoChildren) {
+        const bool object = this->json[s.begin] == '{';
+        const char* end = this->json + this->length;
+        const char* p = this->json + s.begin + 1;
+        s.children = this->children.size();
+        for (size_t i = 0; i < s.count; ++i) {
+            p = skip_whitespace(p);
+            if (object) {
+                this->children.push_back(p - this->json);
+                p = skip_whitespace(skip_string(p, end)) + 1; /* past the colon */
+                p = skip_whitespace(p);
+            }
+            this->children.push_back(p - this->json);
+            p = skip_whitespace(this->skip_value(p)) + 1; /* past the comma or bracket */
+        }
+    }
+    return this->children.data() + s.children;
+}
+
+e_types LazyValue::get_type() const {
+    assert(this->doc != nullptr);
+    switch (this->doc->json[this->pos]) {
+        case 'n': return NONE;
+        case 't': return TRUE;
+        case 'f': return FALSE;
+        case '"': return STRING;
+        case '[': return ARRAY;
+        case '{': return OBJECT;
+        default: return NUMBER;
+    }
+}
+
+double LazyValue::get_number() const {
+    assert(this->get_type() == NUMBER);
+    double n;
+    const char* stop;
+    parse_number_span(this->doc->json + this->pos, this->doc->json + this->doc->length, n, stop);
+    return n;
+}
+
+string LazyValue::get_string() const {
+    assert(this->get_type() == STRING);
+    const char* p = this->doc->json + this->pos + 1;
+    const char* end = this->doc->json + this->doc->length;
+    const char* q = skip_plain_chars(p, end);
+    if (*q == '"') return string(p, q);
+    LeptValue v; /* has escapes, decode it with the parser */
+    if (parse(v, p - 1, skip_string(p - 1, end) - (p - 1)) != PARSE_OK) return string();
+    return string(v.get_string(), v.get_string_length());
+}
+
+size_t LazyValue::get_array_size() const {
+    assert(this->get_type() == ARRAY);
+    return this->doc->span_at(this->pos).count;
+}
+
+LazyValue LazyValue::get_array_element(size_t index) const {
+    assert(index < this->get_array_size());
+    return LazyValue(this->doc, this->doc->children_of(this->doc->span_at(this->pos))[index]);
+}
+
+size_t LazyValue::get_object_size() const {
+    assert(this->get_type() == OBJECT);
+    return this->doc->span_at(this->pos).count;
+}
+
+string LazyValue::get_object_key(size_t index) const {
+    assert(index < this->get_object_size());
+    return LazyValue(this->doc, this->doc->children_of(this->doc->span_at(this->pos))[2 * index])
+        .get_string();
+}
+
+LazyValue LazyValue::get_object_value(size_t index) const {
+    assert(index < this->get_object_size());
+    return LazyValue(this->doc,
+                     this->doc->children_of(this->doc->span_at(this->pos))[2 * index + 1]);
+}
+
+LazyValue LazyValue::get_object_value(const string& key) const {
+    assert(this->get_type() == OBJECT);
+    const LazySpan& s = this->doc->span_at(this->pos);
+    const size_t* child = this->doc->children_of(s);
+    const char* end = this->doc->json + this->doc->length;
+    for (size_t i = 0; i < s.count; ++i) {
+        const char* k = this->doc->json + child[2 * i] + 1;
+        const char* q = skip_plain_chars(k, end);
+        if (*q == '"') { /* compare plain keys in place */
+            if ((size_t)(q - k) == key.size() && memcmp(k, key.data(), key.size()) == 0)
+                return LazyValue(this->doc, child[2 * i + 1]);
+        } else if (this->get_object_key(i) == key) {
+            return LazyValue(this->doc, child[2 * i + 1]);
+        }
+    }
+    return LazyValue();
+}
+
+const char* LazyValue::get_json() const { return this->doc->json + this->pos; }
+
+size_t LazyValue::get_json_length() const { return this->doc->skip_value(this->get_json()) - this->get_json(); }
+
+int LazyValue::get_value(LeptValue& v) const {
+    assert(this->doc != nullptr);
+    return parse(v, this->get_json(), this->get_json_length());
+}
+
+}  // namespace lept
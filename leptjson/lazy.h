@@ -0,0 +1,87 @@
+#ifndef LEPTJSON_LAZY_H
+#define LEPTJSON_LAZY_H
+
+#include <string>
+#include <vector>
+
+#include "leptjson.h"
+
+namespace lept {
+
+class LazyDocument;
+
+/* byte range of one array or object in the input */
+struct LazySpan {
+    size_t begin;    /* the '[' or '{' */
+    size_t end;      /* one past the ']' or '}' */
+    size_t count;    /* elements or members */
+    mutable size_t children; /* first entry in LazyDocument::children, npos until first access */
+};
+
+/* Handle to a value inside a LazyDocument, cheap to copy. Strings and numbers are decoded each
+ * time they are read; a handle from a failed lookup is empty and converts to false. */
+class LazyValue {
+   public:
+    LazyValue() : doc(nullptr), pos(0) {}
+    explicit operator bool() const { return this->doc != nullptr; }
+
+    e_types get_type() const;
+    bool get_boolean() const { return this->get_type() == TRUE; }
+    double get_number() const;
+    string get_string() const;
+
+    size_t get_array_size() const;
+    LazyValue get_array_element(size_t index) const;
+    size_t get_object_size() const;
+    string get_object_key(size_t index) const;
+    LazyValue get_object_value(size_t index) const;
+    LazyValue get_object_value(const string& key) const;
+
+    /* builds the subtree as a LeptValue */
+    int get_value(LeptValue& v) const;
+    /* the value's JSON text, as it appears in the input */
+    const char* get_json() const;
+    size_t get_json_length() const;
+
+   private:
+    friend class LazyDocument;
+    LazyValue(const LazyDocument* doc, size_t pos) : doc(doc), pos(pos) {}
+
+    const LazyDocument* doc;
+    size_t pos; /* offset of the first byte */
+};
+
+/* Lazy mode: parse() makes one structural pass that checks the grammar and records where each
+ * array and object begins and ends, without decoding strings or converting numbers. It fails
+ * with the same error as parse(LeptValue&, ...), except that numbers out of range and unpaired
+ * surrogates are only found when the value is read: get_value() reports them, get_number() then
+ * gives what strtod does and get_string() an empty string. Children are located on first access and then cached,
+ * nothing else is built until asked for. The input is not copied and must outlive the
+ * document. Reading through const handles fills the cache, so share a document between threads
+ * only after the parts they read have been reached once. */
+class LazyDocument {
+   public:
+    LazyDocument() : json(nullptr), length(0), root(0), ok(false) {}
+    int parse(const char* json, size_t length);
+    int parse(const string& strJson) { return this->parse(strJson.data(), strJson.size()); }
+    int parse(string&&) = delete; /* a temporary would not outlive the document */
+    /* empty after a failed parse */
+    LazyValue get_root() const;
+
+   private:
+    friend class LazyValue;
+    const LazySpan& span_at(size_t pos) const;
+    const size_t* children_of(const LazySpan& s) const;
+    const char* skip_value(const char* p) const;
+
+    const char* json;
+    size_t length;
+    vector<LazySpan> spans;           /* in document order */
+    mutable vector<size_t> children;  /* element, or key and value, offsets per container */
+    size_t root;
+    bool ok;
+};
+
+}  // namespace lept
+
+#endif /* LEPTJSON_LAZY_H */
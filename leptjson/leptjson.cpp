@@ -1,75 +1,407 @@
+#include <atomic>
 #include <cassert> /* assert() */
-// #include <cmath>
-#include <iomanip>
-#include <iostream>
-#include <sstream>
+#include <cerrno>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <new>
 #include <stdexcept>
 #include <string>
 #include <vector>
 
+#include "dtoa.h"
+#include "internal.h"
+#include "lazy.h"
 #include "leptjson.h"
+#include "scan.h"
+#include "writer.h"
 
 namespace lept {
 
 using std::string;
 
+static std::atomic<size_t> objectIndexThreshold(16);
+static std::atomic<size_t> maxDepth(1024);
+
+size_t get_object_index_threshold() { return objectIndexThreshold.load(std::memory_order_relaxed); }
+
+void set_object_index_threshold(size_t n) { objectIndexThreshold.store(n, std::memory_order_relaxed); }
+
+size_t get_max_depth() { return maxDepth.load(std::memory_order_relaxed); }
+
+void set_max_depth(size_t n) { maxDepth.store(n, std::memory_order_relaxed); }
+
 #define ISDIGIT1TO9(c) (c >= '1' && c <= '9')
 #define ISDIGIT(c) (c >= '0' && c <= '9')
 
+Arena::Arena(size_t blockSize)
+    : head(nullptr), cur(nullptr), end(nullptr), nextSize(blockSize), used(0) {}
+
+Arena::~Arena() { this->release(); }
+
+void* Arena::allocate(size_t size, size_t align) {
+    assert(align && (align & (align - 1)) == 0);
+    uintptr_t p = ((uintptr_t)this->cur + align - 1) & ~(uintptr_t)(align - 1);
+    if (this->cur == nullptr || p + size > (uintptr_t)this->end) {
+        size_t blockSize = sizeof(Block) + size + align;
+        if (blockSize < this->nextSize) blockSize = this->nextSize;
+        Block* b = static_cast<Block*>(::operator new(blockSize)); /* like every other allocation */
+        b->next = this->head;
+        b->size = blockSize;
+        this->head = b;
+        this->cur = reinterpret_cast<char*>(b + 1);
+        this->end = reinterpret_cast<char*>(b) + blockSize;
+        if (this->nextSize < 16 * 1024 * 1024) this->nextSize *= 2;
+        p = ((uintptr_t)this->cur + align - 1) & ~(uintptr_t)(align - 1);
+    }
+    this->cur = reinterpret_cast<char*>(p + size);
+    this->used += size;
+    return reinterpret_cast<void*>(p);
+}
+
+void Arena::reset() {
+    Block* keep = this->head;
+    for (Block* b = this->head; b; b = b->next)
+        if (b->size > keep->size) keep = b;
+    for (Block* b = this->head; b;) {
+        Block* next = b->next;
+        if (b != keep) ::operator delete(b);
+        b = next;
+    }
+    this->head = keep;
+    this->used = 0;
+    if (keep) {
+        keep->next = nullptr;
+        this->cur = reinterpret_cast<char*>(keep + 1);
+        this->end = reinterpret_cast<char*>(keep) + keep->size;
+    }
+}
+
+void Arena::release() {
+    for (Block* b = this->head; b;) {
+        Block* next = b->next;
+        ::operator delete(b);
+        b = next;
+    }
+    this->head = nullptr;
+    this->cur = this->end = nullptr;
+    this->used = 0;
+}
+
+/* ---- LeptValue arrays and objects: one ElementBlock followed by the elements ---- */
+
+template <class T>
+static T* new_block(Arena* arena, size_t capacity) {
+    if (capacity > UINT32_MAX) throw std::length_error("LeptValue: too many elements");
+    const size_t bytes = sizeof(ElementBlock) + capacity * sizeof(T);
+    void* p = arena ? arena->allocate(bytes, alignof(ElementBlock)) : ::operator new(bytes);
+    ElementBlock* b = static_cast<ElementBlock*>(p);
+    b->arena = arena;
+    b->idx = nullptr;
+    b->keys = nullptr;
+    b->capacity = capacity;
+    return reinterpret_cast<T*>(b + 1);
+}
+
+static void delete_block(ElementBlock* b) {
+    delete b->idx;
+    if (!b->arena) ::operator delete(b);
+}
+
+void LeptValue::relocate(Member* to, Member& from) {
+    new (to) Member(std::move(from.k), LeptValue());
+    relocate(&to->v, from.v);
+    from.~Member();
+}
+
+void LeptValue::relocate(PooledMember* to, PooledMember& from) {
+    new (to) PooledMember(from.k, LeptValue());
+    relocate(&to->v, from.v);
+    from.~PooledMember();
+}
+
+/* moves size elements into a new block of the same arena */
+template <class T>
+T* LeptValue::move_block(T* elems, size_t size, size_t capacity) {
+    ElementBlock* old = reinterpret_cast<ElementBlock*>(elems) - 1;
+    if (!old->arena && !old->keys && capacity == 0) {
+        delete_block(old);
+        return nullptr;
+    }
+    T* fresh = new_block<T>(old->arena, capacity);
+    for (size_t i = 0; i < size; ++i) relocate(&fresh[i], elems[i]);
+    ElementBlock* b = reinterpret_cast<ElementBlock*>(fresh) - 1;
+    std::swap(old->idx, b->idx); /* positions are unchanged */
+    b->keys = old->keys;
+    delete_block(old);
+    return fresh;
+}
+
+void LeptValue::init_container(e_types t, Arena* arena, KeyPool* keys) {
+    /* the heap needs no block for an empty container, an arena or a key pool has to be remembered */
+    if (t == ARRAY) {
+        this->e = arena ? new_block<LeptValue>(arena, 0) : nullptr;
+    } else if (keys) {
+        this->pm = new_block<PooledMember>(arena, 0);
+        block_of(this->pm)->keys = keys;
+    } else {
+        this->m = arena ? new_block<Member>(arena, 0) : nullptr;
+    }
+    this->count = 0;
+    this->type = t;
+    this->interned = keys != nullptr;
+}
+
+void LeptValue::reallocate(size_t capacity) {
+    assert(capacity >= this->count);
+    if (this->type == ARRAY)
+        this->e = this->e ? move_block(this->e, this->count, capacity) : new_block<LeptValue>(nullptr, capacity);
+    else if (this->interned)
+        this->pm = move_block(this->pm, this->count, capacity);
+    else
+        this->m = this->m ? move_block(this->m, this->count, capacity) : new_block<Member>(nullptr, capacity);
+}
+
+/* doubles, starting from about 64 bytes of elements */
+void LeptValue::grow() {
+    const size_t capacity = this->e ? block_of(this->e)->capacity : 0;
+    this->reallocate(capacity ? capacity * 2 : this->type == ARRAY ? 64 / sizeof(LeptValue) : 1);
+}
+
+/* empties the container, keeping its block */
+void LeptValue::destroy_elements() {
+    if (this->type == ARRAY) {
+        for (size_t i = 0; i < this->count; ++i) this->e[i].~LeptValue();
+    } else if (this->m) {
+        if (this->interned)
+            for (size_t i = 0; i < this->count; ++i) this->pm[i].~PooledMember();
+        else
+            for (size_t i = 0; i < this->count; ++i) this->m[i].~Member();
+        delete block_of(this->m)->idx;
+        block_of(this->m)->idx = nullptr;
+    }
+    this->count = 0;
+}
+
+void LeptValue::free_elements() {
+    this->destroy_elements();
+    if (this->e) delete_block(block_of(this->e));
+}
+
+/* keeps the first size elements and the block, an object shrinking loses its index */
+void LeptValue::truncate(size_t size) {
+    assert(size <= this->count);
+    if (size == this->count) return;
+    if (this->type == ARRAY) {
+        for (size_t i = size; i < this->count; ++i) this->e[i].~LeptValue();
+    } else {
+        if (this->interned)
+            for (size_t i = size; i < this->count; ++i) this->pm[i].~PooledMember();
+        else
+            for (size_t i = size; i < this->count; ++i) this->m[i].~Member();
+        delete block_of(this->m)->idx;
+        block_of(this->m)->idx = nullptr;
+    }
+    this->count = (uint32_t)size;
+}
+
+/* overwrites a member's key in place, the index is dropped unless the key stays the same */
+void LeptValue::assign_object_key(size_t index, const char* key, size_t len) {
+    assert(this->type == OBJECT && index < this->count);
+    if (this->interned) {
+        const string*& k = this->pm[index].k;
+        if (k->size() == len && memcmp(k->data(), key, len) == 0) return;
+        k = block_of(this->pm)->keys->intern(string(key, len));
+    } else {
+        string& k = this->m[index].k;
+        if (k.size() == len && memcmp(k.data(), key, len) == 0) return;
+        k.assign(key, len);
+    }
+    delete block_of(this->m)->idx;
+    block_of(this->m)->idx = nullptr;
+}
+
+/* a deep copy on the heap, or in this container's arena when assigning to the same kind.
+ * Interned keys are copied out of their pool, the copy does not depend on it. */
+void LeptValue::copy_container(const LeptValue& rhs) {
+    Arena* arena = this->type == rhs.type && this->e ? block_of(this->e)->arena : nullptr;
+    LeptValue copy;
+    copy.init_container((e_types)rhs.type, arena);
+    if (rhs.count) copy.reallocate(rhs.count);
+    if (rhs.type == ARRAY) {
+        for (; copy.count < rhs.count; ++copy.count) new (&copy.e[copy.count]) LeptValue(rhs.e[copy.count]);
+    } else {
+        for (; copy.count < rhs.count; ++copy.count)
+            new (&copy.m[copy.count]) Member(rhs.get_object_key(copy.count), rhs.get_object_value(copy.count));
+        if (rhs.interned)
+            copy.update_index();
+        else if (rhs.has_object_index())
+            block_of(copy.m)->idx = new KeyIndex(*block_of(rhs.m)->idx);
+    }
+    this->move_within(copy);
+}
+
+/* called after the member list changed as a whole */
+void LeptValue::update_index() {
+    if (!this->m) return;
+    KeyIndex*& idx = block_of(this->m)->idx;
+    delete idx;
+    idx = nullptr;
+    if (this->count < get_object_index_threshold()) return;
+    if (this->interned)
+        idx = new KeyIndex(this->pm, this->count);
+    else
+        idx = new KeyIndex(this->m, this->count);
+}
+
 typedef struct {
-    string strJson;
-    string::const_iterator json;
+    const char* json; /* current position */
+    const char* end;  /* one past the last byte, the buffer is not NUL-terminated */
+    string buf;       /* decoded text of the current string when it has escapes */
+    size_t maxDepth;  /* arrays and objects that may still be opened */
+    bool insitu;      /* json is the caller's to overwrite, strings are decoded there */
 } context;
 
 static void parse_whitespace(context& c) {
-    while (*c.json == ' ' || *c.json == '\t' || *c.json == '\n' || *c.json == '\r') ++c.json;
+    while (c.json != c.end &&
+           (*c.json == ' ' || *c.json == '\t' || *c.json == '\n' || *c.json == '\r'))
+        ++c.json;
 }
 
-static int parse_literal(context& c, LeptValue& v, const string& literal, e_types type) {
+static int parse_literal(context& c, const char* literal, size_t len) {
     assert(*c.json == literal[0]);
-    for (auto itRef = literal.cbegin(); itRef != literal.cend(); ++itRef) {
-        if (*c.json != *itRef) return PARSE_INVALID_VALUE;
-        ++c.json;
+    if ((size_t)(c.end - c.json) < len) return PARSE_INVALID_VALUE;
+    for (size_t i = 0; i < len; ++i)
+        if (c.json[i] != literal[i]) return PARSE_INVALID_VALUE;
+    c.json += len;
+    return PARSE_OK;
+}
+
+/* powers of ten that are exactly representable as a double */
+static const double kExactPow10[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+                                     1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+                                     1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+/* Clinger's fast path: an exact mantissa times an exact power of ten rounds correctly */
+static bool number_fast_path(uint64_t m, int e, double& d) {
+    const uint64_t kMaxExact = (uint64_t)1 << 53;
+    if (m > kMaxExact) return false;
+    if (e < 0) {
+        if (e < -22) return false;
+        d = (double)m / kExactPow10[-e];
+        return true;
+    }
+    if (e > 22) {
+        /* 1e30 == 1e8 * 1e22 while the mantissa stays exact */
+        if (e > 22 + 15) return false;
+        uint64_t scale = (uint64_t)kExactPow10[e - 22];
+        if (m > kMaxExact / scale) return false;
+        m *= scale;
+        e = 22;
     }
-    v.set_type(type);
+    d = (double)m * kExactPow10[e];
+    return true;
+}
+
+/* correctly rounded fallback, converts only the validated span [first, last) */
+static int number_slow_path(const char* first, const char* last, double& d) {
+    char buf[64];
+    string heap;
+    size_t len = last - first;
+    const char* str;
+    if (len < sizeof(buf)) {
+        memcpy(buf, first, len);
+        buf[len] = '\0';
+        str = buf;
+    } else { /* only absurdly long literals get here */
+        heap.assign(first, last);
+        str = heap.c_str();
+    }
+    errno = 0;
+    d = strtod(str, nullptr);
+    /* subnormal results also set ERANGE, only overflow and total underflow are errors */
+    if (errno == ERANGE && (d == HUGE_VAL || d == -HUGE_VAL || d == 0.0))
+        return PARSE_NUMBER_TOO_BIG;
     return PARSE_OK;
 }
 
-static int parse_number(context& c, LeptValue& v) {
-    auto p = c.json;
-    if (*p == '-') ++p;
-    if (*p == '0') {
+static int parse_number(context& c, double& n) {
+    const char* p = c.json;
+    const char* end = c.end;
+    uint64_t m = 0; /* first 19 significant digits */
+    int digits = 0; /* significant digits seen, leading zeros excluded */
+    int e = 0;      /* decimal exponent applied to m */
+    bool neg = false;
+    if (p != end && *p == '-') {
+        neg = true;
+        ++p;
+    }
+    if (p != end && *p == '0') {
         ++p;
     } else {
-        if (!ISDIGIT1TO9(*p)) return PARSE_INVALID_VALUE;
-        while (ISDIGIT(*p)) ++p;
+        if (p == end || !ISDIGIT1TO9(*p)) return PARSE_INVALID_VALUE;
+        for (; p != end && ISDIGIT(*p); ++p) {
+            if (digits < 19)
+                m = m * 10 + (*p - '0');
+            else
+                ++e;
+            ++digits;
+        }
     }
-    if (*p == '.') {
+    if (p != end && *p == '.') {
         ++p;
-        if (!ISDIGIT(*p)) return PARSE_INVALID_VALUE;
-        while (ISDIGIT(*p)) ++p;
+        if (p == end || !ISDIGIT(*p)) return PARSE_INVALID_VALUE;
+        for (; p != end && ISDIGIT(*p); ++p) {
+            if (digits == 0 && *p == '0') {
+                --e;
+                continue;
+            }
+            if (digits < 19) {
+                m = m * 10 + (*p - '0');
+                --e;
+            }
+            ++digits;
+        }
     }
-    if (*p == 'e' || *p == 'E') {
+    if (p != end && (*p == 'e' || *p == 'E')) {
         ++p;
-        if (*p == '+' || *p == '-') ++p;
-        if (!ISDIGIT(*p)) return PARSE_INVALID_VALUE;
-        while (ISDIGIT(*p)) ++p;
+        bool expNeg = false;
+        if (p != end && (*p == '+' || *p == '-')) expNeg = (*p++ == '-');
+        if (p == end || !ISDIGIT(*p)) return PARSE_INVALID_VALUE;
+        int exp = 0;
+        for (; p != end && ISDIGIT(*p); ++p)
+            if (exp < 100000) exp = exp * 10 + (*p - '0');
+        e += expNeg ? -exp : exp;
     }
-    try {
-        v.set_number(std::stod(string(c.json, c.strJson.cend())));
-    } catch (std::out_of_range& e) {
-        return PARSE_NUMBER_TOO_BIG;
+    double d;
+    if (m == 0) {
+        d = 0.0;
+    } else if (digits > 19 || !number_fast_path(m, e, d)) {
+        int ret = number_slow_path(c.json, p, d);
+        if (ret != PARSE_OK) return ret;
+        neg = false; /* strtod has applied the sign */
     }
     c.json = p;
-    v.set_type(NUMBER);
+    n = neg ? -d : d;
     return PARSE_OK;
 }
 
-static bool parse_hex4(string::const_iterator& end, unsigned& u) {
+int parse_number_span(const char* json, const char* end, double& n, const char*& stop) {
+    context c;
+    c.json = json;
+    c.end = end;
+    int ret = parse_number(c, n);
+    stop = c.json;
+    return ret;
+}
+
+static bool parse_hex4(const char*& p, const char* end, unsigned& u) {
     int i;
     u = 0;
+    if (end - p < 4) return false;
     for (i = 0; i < 4; i++) {
-        char ch = *end++;
+        char ch = *p++;
         u <<= 4;  // *= 16;
         if (ch >= '0' && ch <= '9')
             u |= ch - '0';
@@ -83,39 +415,71 @@ static bool parse_hex4(string::const_iterator& end, unsigned& u) {
     return true;
 }
 
-static void encode_utf8(string& s, unsigned u) {
+template <class S>
+static void append_utf8(S& s, unsigned u) {
     // 与运算将二进制填充至8位（补0），或运算将前缀改为UTF-8要求（10,110,1110,11110）
     if (u <= 0x7F)
-        s += u & 0xFF;
+        s += (char)(u & 0xFF);
     else if (u <= 0x7FF) {
-        s += 0xC0 | ((u >> 6) & 0xFF);
-        s += 0x80 | (u & 0x3F);
+        s += (char)(0xC0 | ((u >> 6) & 0xFF));
+        s += (char)(0x80 | (u & 0x3F));
     } else if (u <= 0xFFFF) {
-        s += 0xE0 | ((u >> 12) & 0xFF);
-        s += 0x80 | ((u >> 6) & 0x3F);
-        s += 0x80 | (u & 0x3F);
+        s += (char)(0xE0 | ((u >> 12) & 0xFF));
+        s += (char)(0x80 | ((u >> 6) & 0x3F));
+        s += (char)(0x80 | (u & 0x3F));
     } else {
         assert(u <= 0x10FFFF);
-        s += 0xF0 | ((u >> 18) & 0xFF);
-        s += 0x80 | ((u >> 12) & 0x3F);
-        s += 0x80 | ((u >> 6) & 0x3F);
-        s += 0x80 | (u & 0x3F);
+        s += (char)(0xF0 | ((u >> 18) & 0xFF));
+        s += (char)(0x80 | ((u >> 12) & 0x3F));
+        s += (char)(0x80 | ((u >> 6) & 0x3F));
+        s += (char)(0x80 | (u & 0x3F));
     }
 }
 
-static int parse_string_raw(context& c, string& s) {
-    assert(*c.json == '\"');
-    auto end = ++(c.json);
+void encode_utf8(string& s, unsigned u) { append_utf8(s, u); }
+
+/* decoded text written back over the input for parse_insitu. Escapes never decode to more
+ * bytes than they take, so the write position stays behind the read position. */
+class InsituBuffer {
+   public:
+    explicit InsituBuffer(char* p) : first(p), last(p) {}
+    void append(const char* from, const char* to) {
+        memmove(this->last, from, to - from);
+        this->last += to - from;
+    }
+    InsituBuffer& operator+=(char ch) {
+        *this->last++ = ch;
+        return *this;
+    }
+    const char* data() const { return this->first; }
+    size_t size() const { return this->last - this->first; }
+    void terminate() { *this->last = '\0'; } /* at most where the closing quote was */
+
+   private:
+    char* first;
+    char* last;
+};
+
+/* decodes the rest of a string whose plain text [p, q) stops short of the closing quote */
+template <class S>
+static int parse_string_escaped(context& c, const char* p, const char* q, S& s, const char*& str,
+                                size_t& len) {
     char ch;
-    while (end != c.strJson.cend()) {
-        ch = *end++;
+    while (true) {
+        s.append(p, q);  // 整段复制不含转义的内容
+        if (q == c.end) break;
+        p = q;
+        ch = *p++;
         unsigned u, u2;
         switch (ch) {
             case '\"':
-                c.json = end;  // 收引号的下一位
+                c.json = p;
+                str = s.data();
+                len = s.size();
                 return PARSE_OK;
             case '\\':
-                switch (*end++) {
+                if (p == c.end) return PARSE_INVALID_STRING_ESCAPE;
+                switch (*p++) {
                     case '\"': s += '\"'; break;
                     case '\\': s += '\\'; break;
                     case '/': s += '/'; break;
@@ -125,230 +489,464 @@ static int parse_string_raw(context& c, string& s) {
                     case 'r': s += '\r'; break;
                     case 't': s += '\t'; break;
                     case 'u':
-                        if (!(parse_hex4(end, u))) return PARSE_INVALID_UNICODE_HEX;
+                        if (!(parse_hex4(p, c.end, u))) return PARSE_INVALID_UNICODE_HEX;
                         if (u >= 0xD800 && u <= 0xDBFF) { /* surrogate pair */
-                            if (*end++ != '\\') return PARSE_INVALID_UNICODE_SURROGATE;
-                            if (*end++ != 'u') return PARSE_INVALID_UNICODE_SURROGATE;
-                            if (!(parse_hex4(end, u2))) return PARSE_INVALID_UNICODE_HEX;
+                            if (p == c.end || *p++ != '\\') return PARSE_INVALID_UNICODE_SURROGATE;
+                            if (p == c.end || *p++ != 'u') return PARSE_INVALID_UNICODE_SURROGATE;
+                            if (!(parse_hex4(p, c.end, u2))) return PARSE_INVALID_UNICODE_HEX;
                             if (u2 < 0xDC00 || u2 > 0xDFFF) return PARSE_INVALID_UNICODE_SURROGATE;
                             u = (((u - 0xD800) << 10) | (u2 - 0xDC00)) + 0x10000;
                         }
-                        encode_utf8(s, u);
+                        append_utf8(s, u);
                         break;
                     default: return PARSE_INVALID_STRING_ESCAPE;
                 }
                 break;
             default:
-                if ((unsigned char)ch < 0x20) {
-                    return PARSE_INVALID_STRING_CHAR;
-                }
-                s += ch;
+                assert((unsigned char)ch < 0x20);
+                return PARSE_INVALID_STRING_CHAR;
         }
+        q = skip_plain_chars(p, c.end);
     }
     return PARSE_MISS_QUOTATION_MARK;
 }
 
-static int parse_string(context& c, LeptValue& v) {
+/* plain strings are handed out as a pointer into the input, others are decoded into c.buf,
+ * or over the input itself when parsing in situ */
+static int parse_string_raw(context& c, const char*& str, size_t& len) {
+    assert(*c.json == '\"');
+    const char* p = ++(c.json);
+    const char* q = skip_plain_chars(p, c.end);
+    if (q != c.end && *q == '\"') {
+        str = p;
+        len = q - p;
+        c.json = q + 1;  // 收引号的下一位
+        if (c.insitu) *const_cast<char*>(q) = '\0';
+        return PARSE_OK;
+    }
+    if (c.insitu) {
+        InsituBuffer s(const_cast<char*>(p));
+        int ret = parse_string_escaped(c, p, q, s, str, len);
+        if (ret == PARSE_OK) s.terminate();
+        return ret;
+    }
+    c.buf.clear();
+    return parse_string_escaped(c, p, q, c.buf, str, len);
+}
+
+#define HANDLER_CALL(call) ((call) ? PARSE_OK : PARSE_TERMINATED)
+
+/* the parser below validates and reports what it sees to a SAX handler H,
+ * either the public virtual Handler or a concrete one such as ValueBuilder */
+template <class H>
+static int parse_string(context& c, H& h) {
+    const char* str;
+    size_t len;
     int ret;
-    string s("");
-    if ((ret = parse_string_raw(c, s)) == PARSE_OK) v.set_string(s);
-    return ret;
+    if ((ret = parse_string_raw(c, str, len)) != PARSE_OK) return ret;
+    return HANDLER_CALL(h.String(str, len));
 }
 
-static int parse_value(context& c, LeptValue& v);
+/* the virtual Handler also gets the text of numbers, concrete handlers only the double */
+template <class H>
+static bool number_event(H& h, const char*, size_t, double n) {
+    return h.Number(n);
+}
 
-static int parse_array(context& c, LeptValue& v) {
-    assert(*(c.json)++ == '[');
+static bool number_event(Handler& h, const char* str, size_t len, double n) {
+    return h.RawNumber(str, len, n);
+}
+
+/* reads a member key and the colon after it */
+template <class H>
+static int parse_key(context& c, H& h) {
+    const char* key;
+    size_t len;
+    int ret;
+    if (c.json == c.end || *c.json != '\"') return PARSE_MISS_KEY;
+    if ((ret = parse_string_raw(c, key, len)) != PARSE_OK) return ret;
+    if (!h.Key(key, len)) return PARSE_TERMINATED;
     parse_whitespace(c);
-    if (*c.json == ']') {
-        c.json++;
-        v.init_array();
-        return PARSE_OK;
-    }
+    if (c.json == c.end || *(c.json++) != ':') return PARSE_MISS_COLON;
+    parse_whitespace(c);
+    return PARSE_OK;
+}
+
+/* Iterative: arrays and objects push a frame instead of recursing. After each value the loop
+ * at the bottom closes the containers that end there and finds where the next value starts. */
+template <class H>
+static int parse_value(context& c, H& h) {
+    FrameStack<> stack;
+    const size_t maxDepth = c.maxDepth;
     int ret;
-    vector<LeptValue> vecVal;
+    double n;
     while (true) {
-        LeptValue val;
-        if ((ret = parse_value(c, val)) != PARSE_OK) break;
-        vecVal.push_back(val);
-        parse_whitespace(c);
-        if (*c.json == ',') {
-            c.json++;
+        if (c.json == c.end) return PARSE_EXPECT_VALUE;
+        switch (*c.json) {
+            case 't':
+                if ((ret = parse_literal(c, "true", 4)) != PARSE_OK) return ret;
+                if (!h.Bool(true)) return PARSE_TERMINATED;
+                break;
+            case 'f':
+                if ((ret = parse_literal(c, "false", 5)) != PARSE_OK) return ret;
+                if (!h.Bool(false)) return PARSE_TERMINATED;
+                break;
+            case 'n':
+                if ((ret = parse_literal(c, "null", 4)) != PARSE_OK) return ret;
+                if (!h.Null()) return PARSE_TERMINATED;
+                break;
+            case '"':
+                if ((ret = parse_string(c, h)) != PARSE_OK) return ret;
+                break;
+            case '[':
+                if (stack.depth() >= maxDepth) return PARSE_DEPTH_EXCEEDED;
+                c.json++;
+                if (!h.StartArray()) return PARSE_TERMINATED;
+                parse_whitespace(c);
+                if (c.json != c.end && *c.json == ']') {
+                    c.json++;
+                    if (!h.EndArray(0)) return PARSE_TERMINATED;
+                    break;
+                }
+                stack.push(Frame{nullptr, 0, '['});
+                continue;
+            case '{':
+                if (stack.depth() >= maxDepth) return PARSE_DEPTH_EXCEEDED;
+                c.json++;
+                if (!h.StartObject()) return PARSE_TERMINATED;
+                parse_whitespace(c);
+                if (c.json != c.end && *c.json == '}') {
+                    c.json++;
+                    if (!h.EndObject(0)) return PARSE_TERMINATED;
+                    break;
+                }
+                if ((ret = parse_key(c, h)) != PARSE_OK) return ret;
+                stack.push(Frame{nullptr, 0, '{'});
+                continue;
+            default: {
+                const char* start = c.json;
+                if ((ret = parse_number(c, n)) != PARSE_OK) return ret;
+                if (!number_event(h, start, c.json - start, n)) return PARSE_TERMINATED;
+                break;
+            }
+        }
+        while (true) { /* a value is complete */
+            if (stack.empty()) return PARSE_OK;
+            Frame& f = stack.top();
+            ++f.count;
             parse_whitespace(c);
-        } else if (*c.json == ']') {
-            c.json++;
-            v.set_array(vecVal);
-            return PARSE_OK;  // 直接返回且不释放 vecVal
-            break;
-        } else {
-            ret = PARSE_MISS_COMMA_OR_SQUARE_BRACKET;
-            break;
+            if (f.kind == '[') {
+                if (c.json == c.end) return PARSE_MISS_COMMA_OR_SQUARE_BRACKET;
+                if (*c.json == ',') {
+                    c.json++;
+                    parse_whitespace(c);
+                    break;
+                }
+                if (*c.json != ']') return PARSE_MISS_COMMA_OR_SQUARE_BRACKET;
+                c.json++;
+                if (!h.EndArray(f.count)) return PARSE_TERMINATED;
+            } else {
+                if (c.json == c.end) return PARSE_MISS_COMMA_OR_CURLY_BRACKET;
+                if (*c.json == ',') {
+                    c.json++;
+                    parse_whitespace(c);
+                    if ((ret = parse_key(c, h)) != PARSE_OK) return ret;
+                    break;
+                }
+                if (*c.json != '}') return PARSE_MISS_COMMA_OR_CURLY_BRACKET;
+                c.json++;
+                if (!h.EndObject(f.count)) return PARSE_TERMINATED;
+            }
+            stack.pop();
         }
     }
-    return ret;
 }
 
-static int parse_object(context& c, LeptValue& v) {
-    assert(*(c.json++) == '{');
-    parse_whitespace(c);
-    if (*c.json == '}') {
-        c.json++;
-        v.init_object();
-        return PARSE_OK;
-    }
+template <class H>
+static int parse_document(context& c, H& h, const char* json, size_t length) {
     int ret;
-    vector<Member> vecMem;
-    while (true) {
-        Member mem;
-        mem.k = string("");
-        if (*c.json != '\"') {
-            ret = PARSE_MISS_KEY;
-            break;
-        }
-        if ((ret = parse_string_raw(c, mem.k) != PARSE_OK)) break;
-        parse_whitespace(c);
-        if (*(c.json++) != ':') {
-            ret = PARSE_MISS_COLON;
-            break;
-        }
-        parse_whitespace(c);
-        if ((ret = parse_value(c, mem.v)) != PARSE_OK) break;
-        vecMem.push_back(mem);
+    assert(json != nullptr || length == 0);
+    c.json = json;
+    c.end = json + length;
+    parse_whitespace(c);
+    ret = parse_value(c, h);
+    if (ret == PARSE_OK) {
         parse_whitespace(c);
-        if (*c.json == ',') {
-            c.json++;
-            parse_whitespace(c);
-        } else if (*c.json == '}') {
-            c.json++;
-            v.set_object(vecMem);
-            return PARSE_OK;
-        } else {
-            ret = PARSE_MISS_COMMA_OR_CURLY_BRACKET;
-            break;
-        }
+        if (c.json != c.end) ret = PARSE_ROOT_NOT_SINGULAR;  // 字符串结尾
     }
     return ret;
 }
 
-static int parse_value(context& c, LeptValue& v) {
-    if (c.json == c.strJson.cend()) return PARSE_EXPECT_VALUE;
-    switch (*c.json) {
-        case 't': return parse_literal(c, v, "true", TRUE);
-        case 'f': return parse_literal(c, v, "false", FALSE);
-        case 'n': return parse_literal(c, v, "null", NONE);
-        case '"': return parse_string(c, v);
-        case '[': return parse_array(c, v);
-        case '{': return parse_object(c, v);
-        default: return parse_number(c, v);
+template <class H>
+static int parse_document(H& h, const char* json, size_t length, size_t maxDepth) {
+    context c;
+    c.maxDepth = maxDepth;
+    c.insitu = false;
+    return parse_document(c, h, json, length);
+}
+
+/* the handler for parse_reuse: the document is written over the old tree slot by slot, so a
+ * container or string found where the same kind of value comes again is kept and refilled */
+class ReuseBuilder {
+   public:
+    explicit ReuseBuilder(LeptValue& v) : root(v) {}
+    bool Null() {
+        this->add().freeVal();
+        return true;
+    }
+    bool Bool(bool b) {
+        this->add().set_boolean(b);
+        return true;
+    }
+    bool Number(double n) {
+        this->add().set_number(n);
+        return true;
+    }
+    bool String(const char* s, size_t len) {
+        this->add().set_string(s, len);
+        return true;
+    }
+    bool StartObject() {
+        LeptValue& v = this->add();
+        if (v.get_type() != OBJECT) v.init_object();
+        this->stack.push(Slot{&v, 0});
+        return true;
+    }
+    bool Key(const char* s, size_t len) {
+        Slot& top = this->stack.top();
+        if (top.next < top.v->count)
+            top.v->assign_object_key(top.next, s, len);
+        else
+            top.v->pushback_object_member(string(s, len), LeptValue());
+        return true;
+    }
+    bool EndObject(size_t) {
+        LeptValue& v = *this->stack.top().v;
+        v.truncate(this->stack.top().next);
+        if (!v.has_object_index()) v.update_index();
+        this->stack.pop();
+        return true;
+    }
+    bool StartArray() {
+        LeptValue& v = this->add();
+        if (v.get_type() != ARRAY) v.init_array();
+        this->stack.push(Slot{&v, 0});
+        return true;
+    }
+    bool EndArray(size_t) {
+        this->stack.top().v->truncate(this->stack.top().next);
+        this->stack.pop();
+        return true;
+    }
+
+   private:
+    struct Slot {
+        LeptValue* v; /* an open array or object */
+        size_t next;  /* position of its next value */
+    };
+
+    /* the old value at the next position, or a new element; Key has placed the member already */
+    LeptValue& add() {
+        if (this->stack.empty()) return this->root;
+        Slot& top = this->stack.top();
+        LeptValue& v = *top.v;
+        if (v.get_type() == OBJECT) return v.get_object_value(top.next++);
+        if (top.next == v.count) v.pushback_array_element(LeptValue());
+        return v.get_array_element(top.next++);
     }
+
+    LeptValue& root;
+    FrameStack<Slot> stack; /* kept per thread between parses like the parser's frames */
+};
+
+static int parse_root(LeptValue& v, const char* json, size_t length, Arena* arena,
+                      size_t maxDepth, KeyPool* keys = nullptr, bool insitu = false) {
+    ValueBuilder builder(v, arena, keys, insitu);
+    v.freeVal();
+    context c;
+    c.maxDepth = maxDepth;
+    c.insitu = insitu;
+    int ret = parse_document(c, builder, json, length);
+    if (ret != PARSE_OK) v.freeVal();
+    return ret;
 }
 
-int parse(LeptValue& v, const string& strJson) {
+int parse_in_arena(LeptValue& v, const char* json, size_t length, Arena* arena) {
+    return parse_root(v, json, length, arena, get_max_depth());
+}
+
+int parse_nested(LeptValue& v, const char* json, size_t length, size_t depth) {
+    const size_t maxDepth = get_max_depth();
+    return parse_root(v, json, length, nullptr, depth < maxDepth ? maxDepth - depth : 0);
+}
+
+int parse(Handler& h, const char* json, size_t length) {
+    return parse_document(h, json, length, get_max_depth());
+}
+
+int parse(Handler& h, const string& strJson) { return parse(h, strJson.data(), strJson.size()); }
+
+int parse_insitu(Handler& h, char* json, size_t length) {
     context c;
-    int ret;
-    c.strJson = strJson;
-    c.json = c.strJson.cbegin();
-    v.freeVal();
-    parse_whitespace(c);
-    ret = parse_value(c, v);
-    if (ret == PARSE_OK) {
-        parse_whitespace(c);
-        if (c.json != c.strJson.cend()) {  // 字符串结尾
-            v.set_type(NONE);
-            ret = PARSE_ROOT_NOT_SINGULAR;
-        }
-    }
+    c.maxDepth = get_max_depth();
+    c.insitu = true;
+    return parse_document(c, h, json, length);
+}
+
+int parse_insitu(LeptValue& v, char* json, size_t length) {
+    return parse_root(v, json, length, nullptr, get_max_depth(), nullptr, true);
+}
+
+int parse(LeptValue& v, const char* json, size_t length) {
+    return parse_root(v, json, length, nullptr, get_max_depth());
+}
+
+int parse_reuse(LeptValue& v, const char* json, size_t length) {
+    ReuseBuilder builder(v);
+    int ret = parse_document(builder, json, length, get_max_depth());
+    if (ret != PARSE_OK) v.freeVal();
     return ret;
 }
 
-static void stringify_string(const string& sOfVal, string& s) {
+int parse_reuse(LeptValue& v, const string& strJson) {
+    return parse_reuse(v, strJson.data(), strJson.size());
+}
+
+int parse(LeptValue& v, const char* json, size_t length, KeyPool* keys) {
+    return parse_root(v, json, length, nullptr, get_max_depth(), keys);
+}
+
+int Document::parse(const char* json, size_t length) {
+    this->root.freeVal();
+    this->arena.reset();
+    return parse_root(this->root, json, length, &this->arena, get_max_depth(), this->keys);
+}
+
+int Document::parse_insitu(char* json, size_t length) {
+    this->root.freeVal();
+    this->arena.reset();
+    return parse_root(this->root, json, length, &this->arena, get_max_depth(), this->keys, true);
+}
+
+int parse(LeptValue& v, const string& strJson) { return parse(v, strJson.data(), strJson.size()); }
+
+int parse(LeptValue& v, const string& strJson, KeyPool* keys) {
+    return parse(v, strJson.data(), strJson.size(), keys);
+}
+
+void write_string(Writer& w, const char* s, size_t length) {
     static const char hex_digits[] = {'0', '1', '2', '3', '4', '5', '6', '7',
                                       '8', '9', 'A', 'B', 'C', 'D', 'E', 'F'};
-    s += '"';
-    for (auto it = sOfVal.cbegin(); it != sOfVal.cend(); it++) {
-        switch (*it) {
-            case '\"':
-                s += '\\';
-                s += '\"';
-                break;
-            case '\\':
-                s += '\\';
-                s += '\\';
-                break;
-            case '\b':
-                s += '\\';
-                s += 'b';
-                break;
-            case '\f':
-                s += '\\';
-                s += 'f';
-                break;
-            case '\n':
-                s += '\\';
-                s += 'n';
-                break;
-            case '\r':
-                s += '\\';
-                s += 'r';
-                break;
-            case '\t':
-                s += '\\';
-                s += 't';
-                break;
-            default:
-                if (*it < 0x20) {
-                    s += '\\';
-                    s += 'u';
-                    s += '0';
-                    s += '0';
-                    s += hex_digits[*it >> 4];
-                    s += hex_digits[*it & 15];
-                } else
-                    s += *it;
+    const char* p = s;
+    const char* end = p + length;
+    w.put('"');
+    while (true) {
+        const char* q = skip_plain_chars(p, end);  // 无需转义的部分整段写入
+        w.write(p, q - p);
+        if (q == end) break;
+        switch (*q) {
+            case '\"': w.write("\\\"", 2); break;
+            case '\\': w.write("\\\\", 2); break;
+            case '\b': w.write("\\b", 2); break;
+            case '\f': w.write("\\f", 2); break;
+            case '\n': w.write("\\n", 2); break;
+            case '\r': w.write("\\r", 2); break;
+            case '\t': w.write("\\t", 2); break;
+            default: {
+                unsigned char ch = *q;
+                char esc[6] = {'\\', 'u', '0', '0', hex_digits[ch >> 4], hex_digits[ch & 15]};
+                w.write(esc, 6);
+            }
         }
+        p = q + 1;
     }
-    s += '"';
-}
-
-static void stringify_value(const LeptValue& v, string& s) {
-    std::stringstream ss;
-    size_t i;
-    switch (v.get_type()) {
-        case NONE: s += "null"; break;
-        case FALSE: s += "false"; break;
-        case TRUE: s += "true"; break;
-        case NUMBER:
-            ss << std::setprecision(17) << v.get_number();
-            s += ss.str();
-            break;
-        case STRING: stringify_string(v.get_string(), s); break;
-        case ARRAY:
-            s += '[';
-            for (i = 0; i < v.get_array_size(); ++i) {
-                stringify_value(v.get_array_element(i), s);
-                s += ',';
-            }
-            if (i) s.pop_back();
-            s += ']';
-            break;
-        case OBJECT:
-            s += '{';
-            for (i = 0; i < v.get_object_size(); ++i) {
-                stringify_string(v.get_object_key(i), s);
-                s += ':';
-                stringify_value(v.get_object_value(i), s);
-                s += ',';
+    w.put('"');
+}
+
+static void stringify_string(const string& sOfVal, Writer& w) {
+    write_string(w, sOfVal.data(), sOfVal.size());
+}
+
+void write_number(Writer& w, double n) {
+    if (w.room() >= 25) {
+        w.advance(dtoa(n, w.pos()));  // dtoa 直接写入输出缓冲区
+    } else {
+        char buffer[25];
+        w.write(buffer, dtoa(n, buffer) - buffer);
+    }
+}
+
+/* iterative like parse_value, the frames come from the same per-thread buffer */
+static void stringify_value(const LeptValue& v, Writer& w) {
+    FrameStack<> stack;
+    const LeptValue* cur = &v;
+    while (true) {
+        switch (cur->get_type()) {
+            case NONE: w.write("null", 4); break;
+            case FALSE: w.write("false", 5); break;
+            case TRUE: w.write("true", 4); break;
+            case NUMBER: write_number(w, cur->get_number()); break;
+            case STRING: write_string(w, cur->get_string(), cur->get_string_length()); break;
+            case ARRAY:
+                if (cur->get_array_size() == 0) {
+                    w.write("[]", 2);
+                    break;
+                }
+                w.put('[');
+                stack.push(Frame{cur, 0, '['});
+                cur = &cur->get_array_element(0);
+                continue;
+            case OBJECT:
+                if (cur->get_object_size() == 0) {
+                    w.write("{}", 2);
+                    break;
+                }
+                w.put('{');
+                stringify_string(cur->get_object_key(0), w);
+                w.put(':');
+                stack.push(Frame{cur, 0, '{'});
+                cur = &cur->get_object_value(0);
+                continue;
+            default: throw "Invalid value type";
+        }
+        while (true) { /* cur is written, move to its next sibling */
+            if (stack.empty()) return;
+            Frame& f = stack.top();
+            const LeptValue& parent = *f.value;
+            size_t i = ++f.count;
+            if (f.kind == '[') {
+                if (i < parent.get_array_size()) {
+                    w.put(',');
+                    cur = &parent.get_array_element(i);
+                    break;
+                }
+                w.put(']');
+            } else {
+                if (i < parent.get_object_size()) {
+                    w.put(',');
+                    stringify_string(parent.get_object_key(i), w);
+                    w.put(':');
+                    cur = &parent.get_object_value(i);
+                    break;
+                }
+                w.put('}');
             }
-            if (i) s.pop_back();
-            s += '}';
-            break;
-        default: throw "Invalid value type";
+            stack.pop();
+        }
     }
 }
 
+bool stringify(const LeptValue& v, Writer& w) {
+    stringify_value(v, w);
+    return w.flush();
+}
+
 string stringify(const LeptValue& v, size_t* length = nullptr) {
-    string s("");
-    stringify_value(v, s);
+    string s;
+    {
+        StringWriter w(s);
+        stringify_value(v, w);
+    }
     if (length != nullptr) *length = s.size();
     return s;
 }
@@ -2,8 +2,17 @@
 #define LEPTJSON_H
 
 #include <assert.h>
+#include <stdint.h>
 
+#include <stddef.h>
+#include <string.h>
+
+#include <functional>
+#include <memory>
+#include <new>
 #include <string>
+#include <unordered_set>
+#include <utility>
 #include <vector>
 
 namespace lept {
@@ -16,11 +25,131 @@ using std::vector;
 class LeptValue;
 
 typedef struct Member Member;
+struct PooledMember;
+
+/* monotonic allocator: memory is handed out from large blocks and only given back all at once */
+class Arena {
+   public:
+    explicit Arena(size_t blockSize = 64 * 1024);
+    ~Arena();
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+    void* allocate(size_t size, size_t align);
+    void reset();   /* forgets every allocation, keeps the largest block for reuse */
+    void release(); /* gives every block back */
+    size_t allocated() const { return this->used; }
+
+   private:
+    struct Block {
+        Block* next;
+        size_t size;
+    };
+    Block* head;
+    char* cur;
+    char* end;
+    size_t nextSize;
+    size_t used;
+};
+
+/* interns object keys: each distinct key is stored once, and objects built with the pool hold a
+ * pointer to it instead of their own copy. It must outlive those objects, and it is not
+ * synchronized, so one thread at a time. */
+class KeyPool {
+   public:
+    KeyPool() = default;
+    KeyPool(const KeyPool&) = delete;
+    KeyPool& operator=(const KeyPool&) = delete;
+    const string* intern(const string& key) { return &*this->keys.insert(key).first; }
+    /* nullptr when key was never interned */
+    const string* find(const string& key) const {
+        auto it = this->keys.find(key);
+        return it == this->keys.end() ? nullptr : &*it;
+    }
+    size_t size() const { return this->keys.size(); }
+
+   private:
+    std::unordered_set<string> keys; /* nodes do not move, so pointers stay valid */
+};
+
+class KeyIndex;
+
+/* arrays and objects keep their elements right after this header, in one allocation */
+struct ElementBlock {
+    Arena* arena;    /* where the block came from, null for the heap */
+    KeyIndex* idx;   /* objects: key -> first position, only for large objects */
+    KeyPool* keys;   /* objects: where the keys are interned, the elements are then PooledMembers */
+    size_t capacity; /* elements that fit */
+};
+
+/* strings too long to be stored in a LeptValue keep their text right after this header, in one
+ * allocation, followed by a NUL */
+struct StringBlock {
+    Arena* arena;    /* where the block came from, null for the heap */
+    size_t length;
+    size_t capacity; /* text that fits, without the NUL */
+};
+
+/* objects with at least this many members keep a hash index of their keys, default 16 */
+size_t get_object_index_threshold();
+void set_object_index_threshold(size_t n);
+
+/* parsers fail with PARSE_DEPTH_EXCEEDED past this many nested arrays and objects, default 1024.
+ * Parsing and stringify do not recurse, but destroying or copying a LeptValue does, so keep it
+ * moderate when building trees from untrusted input. */
+size_t get_max_depth();
+void set_max_depth(size_t n);
 
 int parse(LeptValue& v, const string& strJson);
+/* parses json[0, length) in place, the buffer needs no NUL terminator and is never copied */
+int parse(LeptValue& v, const char* json, size_t length);
+/* objects keep their keys interned in keys, which must outlive v */
+int parse(LeptValue& v, const char* json, size_t length, KeyPool* keys);
+int parse(LeptValue& v, const string& strJson, KeyPool* keys);
+/* parses over the tree already in v: where the new document has the same shape, arrays and
+ * objects keep their capacity, keys and strings their buffers. Other values are replaced. On
+ * failure v is null like after parse(). */
+int parse_reuse(LeptValue& v, const char* json, size_t length);
+int parse_reuse(LeptValue& v, const string& strJson);
 
 string stringify(const LeptValue& v, size_t* length);
 
+/* SAX interface: parse(Handler&, ...) validates exactly like parse(LeptValue&, ...) and reports
+ * each value as it is read instead of building a tree. Returning false from a callback stops
+ * the parse with PARSE_TERMINATED. String and Key text is only valid during the call. */
+class Handler {
+   public:
+    virtual ~Handler() {}
+    virtual bool Null() { return true; }
+    virtual bool Bool(bool) { return true; }
+    virtual bool Number(double) { return true; }
+    /* a number with its text as written, for handlers that need more than a double holds such
+     * as integers past 2^53. Calls Number unless overridden. */
+    virtual bool RawNumber(const char*, size_t, double n) { return this->Number(n); }
+    virtual bool String(const char*, size_t) { return true; }
+    virtual bool StartObject() { return true; }
+    virtual bool Key(const char*, size_t) { return true; }
+    virtual bool EndObject(size_t) { return true; }  // member count
+    virtual bool StartArray() { return true; }
+    virtual bool EndArray(size_t) { return true; }  // element count
+};
+
+int parse(Handler& h, const char* json, size_t length);
+int parse(Handler& h, const string& strJson);
+
+/* parses a file through a read-only mapping, nothing is copied into a string first. SAX String
+ * and Key text without escapes points into the mapping, valid during the call. */
+int parse_file(LeptValue& v, const char* path);
+int parse_file(Handler& h, const char* path);
+
+/* in-situ SAX parse: escapes are decoded over json itself and a NUL is written after each String
+ * and Key, so their text points into json and stays valid as long as the buffer does. json is
+ * left modified, also when the parse fails. */
+int parse_insitu(Handler& h, char* json, size_t length);
+/* in-situ DOM parse: strings are decoded over json as above, and the string values of v point
+ * into it instead of holding a copy. json must outlive v and stay as the parse left it. Object
+ * keys are still copied. */
+int parse_insitu(LeptValue& v, char* json, size_t length);
+
 typedef enum { NONE, FALSE, TRUE, NUMBER, STRING, ARRAY, OBJECT } e_types;
 
 enum {
@@ -37,114 +166,272 @@ enum {
     PARSE_MISS_COMMA_OR_SQUARE_BRACKET,
     PARSE_MISS_KEY,
     PARSE_MISS_COLON,
-    PARSE_MISS_COMMA_OR_CURLY_BRACKET
+    PARSE_MISS_COMMA_OR_CURLY_BRACKET,
+    PARSE_TERMINATED, /* a SAX Handler callback returned false */
+    PARSE_NEED_MORE,  /* PushParser: the document is not complete yet */
+    PARSE_FILE_ERROR, /* parse_file: the file could not be opened or mapped */
+    PARSE_DEPTH_EXCEEDED, /* nesting is deeper than get_max_depth() */
+    PARSE_INVALID_BINARY, /* decode_binary: truncated or malformed input */
+    PARSE_TYPE_MISMATCH   /* parse_struct: a value does not fit the field bound to it */
 };
 
 class LeptValue {
    public:
-    LeptValue() : type(NONE) {}
+    LeptValue() : type(NONE), small(0), interned(false), count(0), n(0) {}
     LeptValue(const LeptValue& v);
+    LeptValue(LeptValue&& v) noexcept;
     ~LeptValue();
     LeptValue& operator=(const LeptValue&);
+    LeptValue& operator=(LeptValue&&) noexcept;
     void freeVal();
     void release();
     e_types get_type() const;
-    void set_type(e_types t);
     bool get_boolean() const;
     void set_boolean(bool b);
     double get_number() const;
     void set_number(double n);
-    const string& get_string() const;
-    string& get_string();
+    const char* get_string() const; /* NUL-terminated, may contain NULs */
     size_t get_string_length() const;
     void init_string();
     void set_string(const string& s);
-    void init_array();
+    /* text too long to be stored in place goes to arena when there is one. A string that already
+     * has room for it is overwritten where it is. */
+    void set_string(const char* s, size_t len, Arena* arena = nullptr);
+    /* refers to s without copying it: s[len] must be a NUL, and s must outlive the value and stay
+     * unchanged. Setting other text later copies it as usual, copies of the value hold their own. */
+    void set_string_view(const char* s, size_t len);
+    void init_array(Arena* arena = nullptr);
     void set_array(const vector<LeptValue>& arr);
+    void set_array(vector<LeptValue>&& arr);
     size_t get_array_size() const;
     size_t get_array_capacity() const;
+    void reserve_array(size_t n);
     void shrink_array();
     void clear_array();
     const LeptValue& get_array_element(size_t index) const;
     LeptValue& get_array_element(size_t index);
     void pushback_array_element(const LeptValue& v);
+    void pushback_array_element(LeptValue&& v);
     void popback_array_element();
     void insert_array_element(const LeptValue& v, size_t index);
+    void insert_array_element(LeptValue&& v, size_t index);
     void erase_array_element(size_t index, size_t count);
-    void init_object();
+    /* with keys, member keys are interned there and compared by address */
+    void init_object(Arena* arena = nullptr, KeyPool* keys = nullptr);
     void set_object(const vector<Member>& obj);
+    void set_object(vector<Member>&& obj);
     size_t get_object_size() const;
     const string& get_object_key(size_t index) const;
     size_t get_object_key_length(size_t index) const;
     const LeptValue& get_object_value(size_t index) const;
     LeptValue& get_object_value(size_t index);
     size_t get_object_index(const string& key) const;
-    LeptValue* get_object_value(const string& key) const;
+    const LeptValue* get_object_value(const string& key) const;
+    LeptValue* get_object_value(const string& key);
+    bool has_object_index() const;
     void pushback_object_member(const string& key, const LeptValue& v);
+    void pushback_object_member(string&& key, LeptValue&& v);
     void remove_object_member(size_t index);
     size_t get_object_capacity() const;
+    void reserve_object(size_t n);
     void shrink_object();
     void clear_object();
     // void move(LeptValue& dst, LeptValue& src);
     // void swap(LeptValue& lhs, LeptValue& rhs);
 
    private:
+    friend class ReuseBuilder;
+    static ElementBlock* block_of(const void* elems) { return (ElementBlock*)elems - 1; }
+    static char* text_of(StringBlock* b) { return reinterpret_cast<char*>(b + 1); }
+    char* short_text() { return reinterpret_cast<char*>(this) + 2; }
+    const char* short_text() const { return reinterpret_cast<const char*>(this) + 2; }
+    bool in_arena() const;
+    /* moves a payload as it is, also one in an arena: for elements staying in their container */
+    static void relocate(LeptValue* to, LeptValue& from);
+    static void relocate(Member* to, Member& from);
+    static void relocate(PooledMember* to, PooledMember& from);
+    void move_within(LeptValue& rhs);
+    template <class T>
+    static T* move_block(T* elems, size_t size, size_t capacity);
+    void init_container(e_types t, Arena* arena, KeyPool* keys = nullptr);
+    void reallocate(size_t capacity);
+    void grow();
+    void destroy_elements();
+    void free_elements();
+    void copy_container(const LeptValue& rhs);
+    void update_index();
+    void truncate(size_t size);
+    void assign_object_key(size_t index, const char* key, size_t len);
+
+    /* strings of up to kShortLength bytes are stored over everything after small, NUL included */
+    static const uint8_t kShortLength = 13;
+    static const uint8_t kLongString = 0xff; /* small: the text is in s */
+    static const uint8_t kViewString = 0xfe; /* small: the text is someone else's, at view */
+
+    /* 16 bytes: the tag and the element count, then the payload or a pointer to it */
+    uint8_t type;   /* e_types */
+    uint8_t small;  /* strings: the length of a short one, kLongString or kViewString */
+    bool interned;  /* an object whose members are PooledMembers */
+    uint32_t count; /* array or object size */
     union {
-        vector<Member> o;    /* object elements */
-        vector<LeptValue> a; /* array elements */
-        string s;            /* string elements */
-        double n;            /* number */
+        Member* m;        /* object members, after an ElementBlock */
+        PooledMember* pm; /* object members with interned keys */
+        LeptValue* e;     /* array elements, after an ElementBlock */
+        StringBlock* s;   /* long string text, after the StringBlock */
+        const char* view; /* string text owned elsewhere, its length in count */
+        double n;         /* number */
     };
-    e_types type;
 };
 
+static_assert(sizeof(LeptValue) == 16, "LeptValue should stay two words, short strings fill them");
+
 struct Member {
     Member() = default;
-    Member(const string& key, const LeptValue val) : k(key), v(val) {}
+    Member(const string& key, const LeptValue& val) : k(key), v(val) {}
+    Member(string&& key, LeptValue&& val) : k(std::move(key)), v(std::move(val)) {}
     string k;    /* Member key string */
     LeptValue v; /* Member LeptValue */
 };
 
-inline LeptValue::LeptValue(const LeptValue& v) { *this = v; }
+/* a member of an object whose keys are interned in a KeyPool */
+struct PooledMember {
+    PooledMember(const string* key, LeptValue&& val) : k(key), v(std::move(val)) {}
+    const string* k;
+    LeptValue v;
+};
+
+/* open addressing table of member positions, the keys stay in the member array */
+class KeyIndex {
+   public:
+    template <class M>
+    KeyIndex(const M* m, size_t size) : count(0) {
+        rebuild(m, size);
+    }
+    template <class M>
+    size_t find(const M* m, const string& key) const;
+    template <class M>
+    void insert(const M* m, size_t index);
+    template <class M>
+    void erase(const M* m, size_t size, size_t index);
+
+   private:
+    static uint32_t hash(const string& key) {
+        size_t h = std::hash<string>()(key);
+        return (uint32_t)(h ^ (h >> 32));
+    }
+    static const string& key_of(const Member& mem) { return mem.k; }
+    static const string& key_of(const PooledMember& mem) { return *mem.k; }
+    /* interned keys are equal only as the same string, key must then come from the pool */
+    static bool same(const Member& mem, const string& key) { return mem.k == key; }
+    static bool same(const PooledMember& mem, const string& key) { return mem.k == &key; }
+    size_t mask() const { return slots.size() - 1; }
+    template <class M>
+    bool place(const M* m, uint32_t h, size_t index);
+    template <class M>
+    void rebuild(const M* m, size_t size);
+    vector<uint64_t> slots; /* hash << 32 | (position + 1), 0 is empty */
+    size_t count;
+};
+
+/* a parse tree whose arrays, objects and long strings all live in one Arena. Tearing it down frees
+ * no strings: one walk destroys what still owns heap memory (object keys longer than
+ * std::string's inline storage, key indexes, values added from the heap), then the blocks go
+ * back at once. Values copied or moved out of a Document go to the heap and may outlive it. */
+class Document {
+   public:
+    Document() = default;
+    int parse(const char* json, size_t length);
+    int parse(const string& strJson) { return this->parse(strJson.data(), strJson.size()); }
+    int parse_file(const char* path);
+    /* parse_insitu() into the arena: the strings point into json, which must outlive the tree */
+    int parse_insitu(char* json, size_t length);
+    const LeptValue& get_root() const { return this->root; }
+    LeptValue& get_root() { return this->root; }
+    Arena& get_arena() { return this->arena; }
+    /* later parses intern object keys in keys, which may be shared between documents but must
+     * outlive their trees; nullptr goes back to a copy of each key per member */
+    void set_key_pool(KeyPool* keys) { this->keys = keys; }
+
+   private:
+    Arena arena;    /* declared first so it is destroyed last */
+    KeyPool* keys = nullptr;
+    LeptValue root;
+};
+
+inline LeptValue::LeptValue(const LeptValue& v) : LeptValue() { *this = v; }
+
+/* a payload in an arena is copied to the heap instead, the arena may go first. The copy cannot
+ * fail but for lack of memory, which terminates. */
+inline LeptValue::LeptValue(LeptValue&& v) noexcept : LeptValue() {
+    if (v.in_arena())
+        *this = v;
+    else
+        relocate(this, v);
+}
+
+inline bool LeptValue::in_arena() const {
+    switch (this->type) {
+        case STRING: return this->small == kLongString && this->s->arena;
+        case ARRAY:
+        case OBJECT: return this->e && block_of(this->e)->arena;
+        default: return false;
+    }
+}
+
+inline void LeptValue::relocate(LeptValue* to, LeptValue& from) {
+    memcpy((void*)to, (const void*)&from, sizeof(LeptValue)); /* whichever payload is set, short text too */
+    from.type = NONE;
+}
+
+/* rhs may live inside this */
+inline void LeptValue::move_within(LeptValue& rhs) {
+    if (this == &rhs) return;
+    LeptValue tmp;
+    relocate(&tmp, rhs);
+    this->freeVal();
+    relocate(this, tmp);
+}
 
 inline LeptValue::~LeptValue() { this->freeVal(); }
 
 inline LeptValue& LeptValue::operator=(const LeptValue& rhs) {
-    if (this->type == rhs.type) {
-        switch (rhs.type) {
-            case NUMBER: this->n = rhs.n; break;
-            case STRING: this->s = rhs.s; break;
-            case ARRAY: this->a = rhs.a; break;
-            case OBJECT: this->o = rhs.o; break;
-            default: break;
-        }
-        return *this;
+    if (this == &rhs) return *this;
+    const uint8_t t = rhs.type; /* rhs may live inside this and go with the old value */
+    if (t == ARRAY || t == OBJECT) {
+        this->copy_container(rhs);
+    } else if (t == STRING) {
+        this->set_string(rhs.get_string(), rhs.get_string_length());
+    } else {
+        const double copy = t == NUMBER ? rhs.n : 0;
+        this->freeVal();
+        this->n = copy;
+        this->type = t;
     }
+    return *this;
+}
+
+/* takes over rhs's payload, wherever it was allocated */
+inline LeptValue& LeptValue::operator=(LeptValue&& rhs) noexcept {
+    if (this == &rhs) return *this;
+    LeptValue tmp(std::move(rhs)); /* rhs may live inside this */
     this->freeVal();
-    switch (rhs.type) {
-        case NUMBER: this->n = rhs.n; break;
-        case STRING: this->set_string(rhs.s); break;
-        case ARRAY: this->set_array(rhs.a); break;
-        case OBJECT: this->set_object(rhs.o); break;
-        default: break;
-    }
-    this->type = rhs.type;
+    new (this) LeptValue(std::move(tmp));
     return *this;
 }
 
 inline void LeptValue::freeVal() {
     switch (this->type) {
-        case STRING: this->s.~string(); break;
-        case ARRAY: this->a.~vector(); break;
-        case OBJECT: this->o.~vector(); break;
+        case STRING:
+            if (this->small == kLongString && !this->s->arena) ::operator delete(this->s);
+            break;
+        case ARRAY:
+        case OBJECT: this->free_elements(); break;
         default: break;
     }
     this->type = NONE;
 }
 
-inline e_types LeptValue::get_type() const { return this->type; }
-
-inline void LeptValue::set_type(e_types t) { this->type = t; }
+inline e_types LeptValue::get_type() const { return (e_types)this->type; }
 
 inline bool LeptValue::get_boolean() const {
     assert(this->type == TRUE || this->type == FALSE);
@@ -167,201 +454,393 @@ inline void LeptValue::set_number(double n) {
     this->type = NUMBER;
 }
 
-inline const string& LeptValue::get_string() const {
-    assert(this->type == STRING);
-    return this->s;
-}
-
-inline string& LeptValue::get_string() {
+inline const char* LeptValue::get_string() const {
     assert(this->type == STRING);
-    return this->s;
+    if (this->small == kLongString) return text_of(this->s);
+    return this->small == kViewString ? this->view : this->short_text();
 }
 
 inline size_t LeptValue::get_string_length() const {
     assert(this->type == STRING);
-    return this->s.size();
+    if (this->small == kLongString) return this->s->length;
+    return this->small == kViewString ? this->count : this->small;
 }
 
-inline void LeptValue::init_string() {
-    if (this->type == STRING) {
-        this->s = "";
+inline void LeptValue::init_string() { this->set_string("", 0); }
+
+inline void LeptValue::set_string(const string& str) { this->set_string(str.data(), str.size()); }
+
+/* str may point into this value's own text, so the old text goes last */
+inline void LeptValue::set_string(const char* str, size_t len, Arena* arena) {
+    if (this->type == STRING && this->small == kLongString && len <= this->s->capacity) {
+        memmove(text_of(this->s), str, len);
+        text_of(this->s)[len] = '\0';
+        this->s->length = len;
         return;
     }
-    this->freeVal();
-    new (&this->s) string("");
+    if (len <= kShortLength) {
+        char text[kShortLength + 1];
+        memcpy(text, str, len);
+        this->freeVal();
+        memcpy(this->short_text(), text, len);
+        this->short_text()[len] = '\0';
+        this->small = (uint8_t)len;
+    } else {
+        size_t capacity = len;
+        if (this->type == STRING && this->small == kLongString) { /* grows like std::string, where it was */
+            arena = this->s->arena;
+            if (capacity < 2 * this->s->capacity) capacity = 2 * this->s->capacity;
+        }
+        const size_t bytes = sizeof(StringBlock) + capacity + 1;
+        StringBlock* b = static_cast<StringBlock*>(arena ? arena->allocate(bytes, alignof(StringBlock))
+                                                         : ::operator new(bytes));
+        b->arena = arena;
+        b->length = len;
+        b->capacity = capacity;
+        memcpy(text_of(b), str, len);
+        text_of(b)[len] = '\0';
+        this->freeVal();
+        this->s = b;
+        this->small = kLongString;
+    }
     this->type = STRING;
 }
 
-inline void LeptValue::set_string(const string& str) {
-    if (this->type == STRING) {
-        this->s = str;
+inline void LeptValue::set_string_view(const char* str, size_t len) {
+    if (len > UINT32_MAX) { /* the length would not fit count */
+        this->set_string(str, len);
         return;
     }
     this->freeVal();
-    new (&this->s) string(str);
+    this->view = str;
+    this->count = (uint32_t)len;
+    this->small = kViewString;
     this->type = STRING;
 }
 
-inline void LeptValue::init_array() {
-    if (this->type == ARRAY) {
-        this->a = vector<LeptValue>();
-        return;
-    }
+inline void LeptValue::init_array(Arena* arena) {
     this->freeVal();
-    new (&this->a) vector<LeptValue>();
-    this->type = ARRAY;
+    this->init_container(ARRAY, arena);
 }
 
 inline void LeptValue::set_array(const vector<LeptValue>& arr) {
-    if (this->type == ARRAY) {
-        this->a = vector<LeptValue>();
-        return;
-    }
-    this->freeVal();
-    new (&this->a) vector<LeptValue>(arr);
-    this->type = ARRAY;
+    LeptValue tmp;
+    tmp.init_container(ARRAY, nullptr);
+    tmp.reserve_array(arr.size());
+    for (const LeptValue& v : arr) tmp.pushback_array_element(v);
+    *this = std::move(tmp);
+}
+
+inline void LeptValue::set_array(vector<LeptValue>&& arr) {
+    LeptValue tmp;
+    tmp.init_container(ARRAY, nullptr);
+    tmp.reserve_array(arr.size());
+    for (LeptValue& v : arr) tmp.pushback_array_element(std::move(v));
+    *this = std::move(tmp);
 }
 
 inline size_t LeptValue::get_array_size() const {
     assert(this->type == ARRAY);
-    return this->a.size();
+    return this->count;
 }
 
 inline size_t LeptValue::get_array_capacity() const {
     assert(this->type == ARRAY);
-    return (this->a).capacity();
+    return this->e ? block_of(this->e)->capacity : 0;
+}
+
+inline void LeptValue::reserve_array(size_t n) {
+    assert(this->type == ARRAY);
+    if (n > this->get_array_capacity()) this->reallocate(n);
 }
 
 inline void LeptValue::shrink_array() {
     assert(this->type == ARRAY);
-    (this->a).shrink_to_fit();
+    if (this->e && !block_of(this->e)->arena && this->count < block_of(this->e)->capacity)
+        this->reallocate(this->count);
 }
 
 inline void LeptValue::clear_array() {
     assert(this->type == ARRAY);
-    (this->a).clear();
+    this->destroy_elements();
 }
 
 inline const LeptValue& LeptValue::get_array_element(size_t index) const {
     assert(this->type == ARRAY);
     assert(index < this->get_array_size());
-    return this->a[index];
+    return this->e[index];
 }
 
 inline LeptValue& LeptValue::get_array_element(size_t index) {
     assert(this->type == ARRAY);
     assert(index < this->get_array_size());
-    return this->a[index];
+    return this->e[index];
 }
 
 inline void LeptValue::pushback_array_element(const LeptValue& v) {
+    this->pushback_array_element(LeptValue(v));
+}
+
+inline void LeptValue::pushback_array_element(LeptValue&& v) {
     assert(this->type == ARRAY);
-    (this->a).push_back(v);
+    if (this->count == this->get_array_capacity()) {
+        LeptValue tmp(std::move(v)); /* v may be one of the elements that move */
+        this->grow();
+        new (&this->e[this->count]) LeptValue(std::move(tmp));
+    } else {
+        new (&this->e[this->count]) LeptValue(std::move(v));
+    }
+    ++this->count;
 }
 
 inline void LeptValue::popback_array_element() {
-    assert(this->type == ARRAY);
-    (this->a).pop_back();
+    assert(this->type == ARRAY && this->count > 0);
+    this->e[--this->count].~LeptValue();
 }
 
 inline void LeptValue::insert_array_element(const LeptValue& v, size_t index) {
-    assert(this->type == ARRAY && index <= (this->a).size());
-    auto it = (this->a).begin() + index;
-    (this->a).insert(it, v);
+    this->insert_array_element(LeptValue(v), index);
+}
+
+inline void LeptValue::insert_array_element(LeptValue&& v, size_t index) {
+    assert(this->type == ARRAY && index <= this->count);
+    LeptValue tmp(std::move(v));
+    this->pushback_array_element(LeptValue());
+    for (size_t i = this->count - 1; i > index; --i) this->e[i].move_within(this->e[i - 1]);
+    this->e[index].move_within(tmp);
 }
 
 inline void LeptValue::erase_array_element(size_t _start, size_t _count) {
-    assert(this->type == ARRAY && _start + _count <= (this->a).size());
-    size_t num = 0;
-    auto it = (this->a).begin() + _start;
-    while (num < _count) {
-        it = (this->a).erase(it);
-        ++num;
-    }
+    assert(this->type == ARRAY && _start + _count <= this->count);
+    for (size_t i = _start; i + _count < this->count; ++i) this->e[i].move_within(this->e[i + _count]);
+    for (size_t i = this->count - _count; i < this->count; ++i) this->e[i].~LeptValue();
+    this->count -= (uint32_t)_count;
 }
 
-inline void LeptValue::init_object() {
-    if (this->type == OBJECT) {
-        this->o = vector<Member>();
-        return;
-    }
+inline void LeptValue::init_object(Arena* arena, KeyPool* keys) {
     this->freeVal();
-    new (&this->o) vector<Member>();
-    this->type = OBJECT;
+    this->init_container(OBJECT, arena, keys);
 }
 
 inline void LeptValue::set_object(const vector<Member>& obj) {
-    if (this->type == OBJECT) {
-        this->o = vector<Member>();
-        return;
-    }
-    this->freeVal();
-    new (&this->o) vector<Member>(obj);
-    this->type = OBJECT;
+    LeptValue tmp;
+    tmp.init_container(OBJECT, nullptr);
+    tmp.reserve_object(obj.size());
+    for (const Member& mem : obj) new (&tmp.m[tmp.count++]) Member(mem);
+    tmp.update_index();
+    *this = std::move(tmp);
+}
+
+inline void LeptValue::set_object(vector<Member>&& obj) {
+    LeptValue tmp;
+    tmp.init_container(OBJECT, nullptr);
+    tmp.reserve_object(obj.size());
+    for (Member& mem : obj) new (&tmp.m[tmp.count++]) Member(std::move(mem));
+    tmp.update_index();
+    *this = std::move(tmp);
 }
 
 inline size_t LeptValue::get_object_size() const {
     assert(this->type == OBJECT);
-    return this->o.size();
+    return this->count;
 }
 
 inline const string& LeptValue::get_object_key(size_t index) const {
     assert(this->type == OBJECT);
     assert(index < this->get_object_size());
-    return (this->o)[index].k;
+    return this->interned ? *this->pm[index].k : this->m[index].k;
 }
 
 inline size_t LeptValue::get_object_key_length(size_t index) const {
-    assert(this->type == OBJECT);
-    assert(index < this->get_object_size());
-    return (this->o)[index].k.size();
+    return this->get_object_key(index).size();
 }
 
 inline const LeptValue& LeptValue::get_object_value(size_t index) const {
     assert(this->type == OBJECT);
     assert(index < this->get_object_size());
-    return this->o[index].v;
+    return this->interned ? this->pm[index].v : this->m[index].v;
 }
 
 inline LeptValue& LeptValue::get_object_value(size_t index) {
     assert(this->type == OBJECT);
     assert(index < this->get_object_size());
-    return this->o[index].v;
+    return this->interned ? this->pm[index].v : this->m[index].v;
 }
 
 inline size_t LeptValue::get_object_index(const std::string& key) const {
     assert(this->type == OBJECT);
-    size_t i = 0;
-    for (const Member& mem : this->o) {
-        if (mem.k == key) return i;
-        ++i;
+    if (this->interned) { /* one lookup in the pool, then addresses */
+        const string* k = block_of(this->pm)->keys->find(key);
+        if (!k) return KEY_NOT_EXIST;
+        if (this->has_object_index()) return block_of(this->pm)->idx->find(this->pm, *k);
+        for (size_t i = 0; i < this->count; ++i)
+            if (this->pm[i].k == k) return i;
+        return KEY_NOT_EXIST;
     }
+    if (this->has_object_index()) return block_of(this->m)->idx->find(this->m, key);
+    for (size_t i = 0; i < this->count; ++i)
+        if (this->m[i].k == key) return i;
     return KEY_NOT_EXIST;
 }
 
+inline const LeptValue* LeptValue::get_object_value(const string& key) const {
+    size_t index = this->get_object_index(key);
+    return index == KEY_NOT_EXIST ? nullptr : &this->get_object_value(index);
+}
+
+inline LeptValue* LeptValue::get_object_value(const string& key) {
+    size_t index = this->get_object_index(key);
+    return index == KEY_NOT_EXIST ? nullptr : &this->get_object_value(index);
+}
+
+inline bool LeptValue::has_object_index() const {
+    assert(this->type == OBJECT);
+    return this->m && block_of(this->m)->idx;
+}
+
 inline void LeptValue::pushback_object_member(const string& key, const LeptValue& v) {
+    this->pushback_object_member(string(key), LeptValue(v));
+}
+
+inline void LeptValue::pushback_object_member(string&& key, LeptValue&& v) {
     assert(this->type == OBJECT);
-    (this->o).push_back(Member(key, v));
+    const size_t capacity = this->get_object_capacity();
+    if (this->interned) {
+        const string* k = block_of(this->pm)->keys->intern(key);
+        LeptValue tmp(std::move(v)); /* v may live in a member that moves */
+        if (this->count == capacity) this->grow();
+        new (&this->pm[this->count]) PooledMember(k, std::move(tmp));
+    } else if (this->count == capacity) {
+        Member tmp(std::move(key), std::move(v)); /* either may live in a member that moves */
+        this->grow();
+        new (&this->m[this->count]) Member(std::move(tmp));
+    } else {
+        new (&this->m[this->count]) Member(std::move(key), std::move(v));
+    }
+    ++this->count;
+    if (!this->has_object_index()) {
+        if (this->count >= get_object_index_threshold()) this->update_index();
+    } else if (this->interned) {
+        block_of(this->pm)->idx->insert(this->pm, this->count - 1);
+    } else {
+        block_of(this->m)->idx->insert(this->m, this->count - 1);
+    }
 }
 
 inline void LeptValue::remove_object_member(size_t index) {
-    assert(this->type == OBJECT && index < (this->o).size());
-    (this->o).erase((this->o).begin() + index);
+    assert(this->type == OBJECT && index < this->count);
+    if (this->interned) {
+        if (this->has_object_index()) block_of(this->pm)->idx->erase(this->pm, this->count, index);
+        for (size_t i = index; i + 1 < this->count; ++i) {
+            this->pm[i].k = this->pm[i + 1].k;
+            this->pm[i].v.move_within(this->pm[i + 1].v);
+        }
+        this->pm[--this->count].~PooledMember();
+        return;
+    }
+    if (this->has_object_index()) block_of(this->m)->idx->erase(this->m, this->count, index);
+    for (size_t i = index; i + 1 < this->count; ++i) {
+        this->m[i].k = std::move(this->m[i + 1].k);
+        this->m[i].v.move_within(this->m[i + 1].v);
+    }
+    this->m[--this->count].~Member();
 }
 
 inline size_t LeptValue::get_object_capacity() const {
     assert(this->type == OBJECT);
-    return (this->o).capacity();
+    return this->m ? block_of(this->m)->capacity : 0;
+}
+
+inline void LeptValue::reserve_object(size_t n) {
+    assert(this->type == OBJECT);
+    if (n > this->get_object_capacity()) this->reallocate(n);
 }
 
 inline void LeptValue::shrink_object() {
     assert(this->type == OBJECT);
-    (this->o).shrink_to_fit();
+    if (this->m && !block_of(this->m)->arena && this->count < block_of(this->m)->capacity)
+        this->reallocate(this->count);
 }
 
 inline void LeptValue::clear_object() {
     assert(this->type == OBJECT);
-    (this->o).clear();
+    this->destroy_elements();
+}
+
+template <class M>
+inline size_t KeyIndex::find(const M* m, const string& key) const {
+    const uint32_t h = hash(key);
+    for (size_t i = h & mask();; i = (i + 1) & mask()) {
+        const uint64_t slot = this->slots[i];
+        if (slot == 0) return KEY_NOT_EXIST;
+        const size_t pos = (uint32_t)slot - 1;
+        if ((uint32_t)(slot >> 32) == h && same(m[pos], key)) return pos;
+    }
+}
+
+/* inserts m[index] unless an earlier member has the same key, returns whether it was added */
+template <class M>
+inline bool KeyIndex::place(const M* m, uint32_t h, size_t index) {
+    size_t i = h & mask();
+    for (; this->slots[i] != 0; i = (i + 1) & mask()) {
+        const uint64_t slot = this->slots[i];
+        if ((uint32_t)(slot >> 32) == h && same(m[(uint32_t)slot - 1], key_of(m[index]))) return false;
+    }
+    this->slots[i] = (uint64_t)h << 32 | (uint64_t)(index + 1);
+    ++this->count;
+    return true;
+}
+
+template <class M>
+inline void KeyIndex::rebuild(const M* m, size_t size) {
+    assert(size < UINT32_MAX);
+    size_t cap = 16;
+    while (cap < size * 2) cap <<= 1;
+    this->slots.assign(cap, 0);
+    this->count = 0;
+    for (size_t i = 0; i < size; ++i) place(m, hash(key_of(m[i])), i);
+}
+
+/* m[index] was just appended */
+template <class M>
+inline void KeyIndex::insert(const M* m, size_t index) {
+    if ((this->count + 1) * 4 > this->slots.size() * 3)
+        rebuild(m, index + 1);
+    else
+        place(m, hash(key_of(m[index])), index);
+}
+
+/* m[index] is about to be erased, positions behind it shift down by one */
+template <class M>
+inline void KeyIndex::erase(const M* m, size_t size, size_t index) {
+    const string& key = key_of(m[index]);
+    const uint32_t h = hash(key);
+    size_t i = h & mask();
+    for (; this->slots[i] != 0; i = (i + 1) & mask())
+        if ((uint32_t)this->slots[i] == index + 1) break;
+    if (this->slots[i] != 0) { /* it was the first member with this key */
+        /* backward shift deletion keeps every probe chain unbroken */
+        size_t j = i;
+        while (true) {
+            j = (j + 1) & mask();
+            if (this->slots[j] == 0) break;
+            const size_t home = (uint32_t)(this->slots[j] >> 32) & mask();
+            if ((j > i && (home <= i || home > j)) || (j < i && home <= i && home > j)) {
+                this->slots[i] = this->slots[j];
+                i = j;
+            }
+        }
+        this->slots[i] = 0;
+        --this->count;
+        for (size_t next = index + 1; next < size; ++next) {
+            if (same(m[next], key)) {
+                place(m, h, next);
+                break;
+            }
+        }
+    }
+    for (uint64_t& slot : this->slots)
+        if ((uint32_t)slot > index + 1) --slot;
 }
 
 }  // namespace lept
@@ -0,0 +1,173 @@
+#include "lines.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "internal.h"
+
+namespace lept {
+
+static const size_t kBatchBytes = 64 * 1024; /* input a worker takes at a time */
+
+/* the line at p without its "\n" or "\r\n", p moves to the next line */
+static void take_line(const char*& p, const char* end, const char*& first, const char*& last) {
+    first = p;
+    const char* nl = (const char*)memchr(p, '\n', end - p);
+    last = nl ? nl : end;
+    p = nl ? nl + 1 : end;
+    if (last != first && last[-1] == '\r') --last;
+}
+
+static bool is_blank(const char* first, const char* last) {
+    for (; first != last; ++first)
+        if (*first != ' ' && *first != '\t' && *first != '\r') return false;
+    return true;
+}
+
+bool LineReader::next() {
+    while (this->p != this->end) {
+        const char *first, *last;
+        take_line(this->p, this->end, first, last);
+        ++this->line;
+        if (is_blank(first, last)) continue;
+        this->ret = this->doc.parse(first, last - first);
+        return true;
+    }
+    return false;
+}
+
+namespace {
+
+struct Record {
+    size_t line; /* within the batch */
+    int ret;
+    LeptValue v;
+};
+
+/* a run of whole lines, parsed by one worker and delivered by the caller */
+struct Batch {
+    enum State { FREE, BUSY, READY };
+    Batch() : state(FREE), lines(0) {}
+    void parse(const char* p, const char* end) {
+        this->records.clear(); /* before the arena they live in */
+        this->arena.reset();
+        this->lines = 0;
+        while (p != end) {
+            const char *first, *last;
+            take_line(p, end, first, last);
+            ++this->lines;
+            if (is_blank(first, last)) continue;
+            this->records.emplace_back();
+            Record& r = this->records.back();
+            r.line = this->lines;
+            r.ret = parse_in_arena(r.v, first, last - first, &this->arena);
+        }
+    }
+    State state;
+    size_t lines;
+    Arena arena;
+    vector<Record> records;
+};
+
+}  // namespace
+
+int parse_lines(const char* data, size_t length, const LineCallback& fn, unsigned threads) {
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    if (threads == 1 || length <= kBatchBytes) {
+        LineReader r(data, length);
+        while (r.next())
+            if (!fn(r.get_line(), r.get_error(), r.get_value())) return PARSE_TERMINATED;
+        return PARSE_OK;
+    }
+
+    const char* const end = data + length;
+    const size_t slots = 2 * threads; /* so workers keep going while the caller delivers */
+    vector<std::unique_ptr<Batch>> batches;
+    for (size_t i = 0; i < slots; ++i) batches.emplace_back(new Batch);
+    std::mutex m;
+    std::condition_variable cv;
+    const char* cursor = data; /* input not yet handed to a worker */
+    size_t taken = 0;          /* batches handed out */
+    bool stop = false;
+    std::exception_ptr error;
+
+    auto work = [&]() {
+        std::unique_lock<std::mutex> lock(m);
+        while (true) {
+            cv.wait(lock, [&]() { return stop || cursor == end || batches[taken % slots]->state == Batch::FREE; });
+            if (stop || cursor == end) return;
+            Batch& b = *batches[taken++ % slots];
+            const char* first = cursor;
+            const char* nl = first + kBatchBytes < end ? (const char*)memchr(first + kBatchBytes, '\n', end - first - kBatchBytes) : nullptr;
+            cursor = nl ? nl + 1 : end;
+            const char* last = cursor;
+            b.state = Batch::BUSY;
+            lock.unlock();
+            try {
+                b.parse(first, last);
+            } catch (...) {
+                lock.lock();
+                if (!error) error = std::current_exception();
+                stop = true;
+                cv.notify_all();
+                return;
+            }
+            lock.lock();
+            b.state = Batch::READY;
+            cv.notify_all();
+        }
+    };
+    vector<std::thread> pool;
+    /* workers must be joined before leaving, also when starting one or the callback throws */
+    auto shutdown = [&]() {
+        {
+            std::lock_guard<std::mutex> lock(m);
+            stop = true;
+        }
+        cv.notify_all();
+        for (std::thread& th : pool) th.join();
+    };
+
+    int ret = PARSE_OK;
+    size_t base = 0; /* lines in the batches delivered so far */
+    try {
+        for (unsigned t = 0; t < threads; ++t) pool.emplace_back(work);
+        for (size_t seq = 0;; ++seq) {
+            std::unique_lock<std::mutex> lock(m);
+            Batch& b = *batches[seq % slots];
+            cv.wait(lock, [&]() { return stop || b.state == Batch::READY || (cursor == end && seq == taken); });
+            if (stop || b.state != Batch::READY) break;
+            lock.unlock();
+            bool more = true;
+            for (const Record& r : b.records)
+                if (!(more = fn(base + r.line, r.ret, r.v))) break;
+            base += b.lines;
+            lock.lock();
+            b.state = Batch::FREE;
+            if (!more) {
+                stop = true;
+                ret = PARSE_TERMINATED;
+            }
+            cv.notify_all();
+            if (!more) break;
+        }
+    } catch (...) {
+        shutdown();
+        throw;
+    }
+    shutdown();
+    if (error) std::rethrow_exception(error);
+    return ret;
+}
+
+int parse_lines(const string& data, const LineCallback& fn, unsigned threads) {
+    return parse_lines(data.data(), data.size(), fn, threads);
+}
+
+}  // namespace lept
@@ -0,0 +1,49 @@
+#ifndef LEPTJSON_LINES_H
+#define LEPTJSON_LINES_H
+
+#include <functional>
+#include <string>
+
+#include "leptjson.h"
+
+namespace lept {
+
+/* JSON Lines / NDJSON: one value per line. Lines end with "\n" or "\r\n", blank lines are
+ * skipped but counted, line numbers start at 1. */
+
+/* Pulls one record at a time, parsed in place into a Document whose arena is reused.
+ *
+ *   LineReader r(data, length);
+ *   while (r.next()) if (r.get_error() == PARSE_OK) use(r.get_value());
+ */
+class LineReader {
+   public:
+    LineReader(const char* data, size_t length) : p(data), end(data + length), line(0), ret(PARSE_OK) {}
+    /* parses the next non-blank line, false when there is none */
+    bool next();
+    size_t get_line() const { return this->line; }
+    int get_error() const { return this->ret; }
+    /* NONE after an error, valid until the next call to next() */
+    const LeptValue& get_value() const { return this->doc.get_root(); }
+
+   private:
+    const char* p;
+    const char* end;
+    size_t line;
+    int ret;
+    Document doc;
+};
+
+/* called with each record in input order: its line number, PARSE_OK or the line's error code,
+ * and the value (NONE after an error), valid during the call. Return false to stop. */
+typedef std::function<bool(size_t line, int ret, const LeptValue& v)> LineCallback;
+
+/* Parses every line. With threads > 1 (0 for every core) that many workers parse batches of
+ * lines, each batch into its own reused arena, while the calling thread runs the callback in
+ * input order. Returns PARSE_TERMINATED if the callback stopped it, else PARSE_OK. */
+int parse_lines(const char* data, size_t length, const LineCallback& fn, unsigned threads = 1);
+int parse_lines(const string& data, const LineCallback& fn, unsigned threads = 1);
+
+}  // namespace lept
+
+#endif /* LEPTJSON_LINES_H */
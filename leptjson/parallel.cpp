@@ -0,0 +1,121 @@
+#include "parallel.h"
+
+#include <algorithm>
+#include <cassert>
+#include <atomic>
+#include <exception>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "internal.h"
+#include "scan.h"
+
+namespace lept {
+
+static const size_t kMinParallelBytes = 64 * 1024; /* below this threads cost more than they save */
+static const size_t kBatch = 64;                    /* elements a worker takes at a time */
+
+static inline bool is_whitespace(char ch) { return ch == ' ' || ch == '\t' || ch == '\n' || ch == '\r'; }
+
+/* Finds the byte range of each element of the root array at p. Only tracks strings and bracket
+ * depth; anything unusual returns false and is left to the serial parser to report. */
+static bool split_elements(const char* p, const char* end, vector<std::pair<const char*, const char*>>& out) {
+    assert(*p == '[');
+    const char* elem = ++p;
+    size_t depth = 0;
+    while (true) {
+        if (p == end) return false;
+        switch (*p) {
+            case '"':
+                for (++p;;) {
+                    p = skip_plain_chars(p, end);
+                    if (p == end) return false;
+                    if (*p == '"') break;
+                    p += *p == '\\' ? 2 : 1; /* an escape, or a control char for the parser to reject */
+                    if (p > end) return false;
+                }
+                break;
+            case '[':
+            case '{': ++depth; break;
+            case ']':
+            case '}':
+                if (depth == 0) {
+                    if (*p != ']') return false;
+                    out.push_back(std::make_pair(elem, p));
+                    for (++p; p != end; ++p)
+                        if (!is_whitespace(*p)) return false;
+                    return true;
+                }
+                --depth;
+                break;
+            case ',':
+                if (depth == 0) {
+                    out.push_back(std::make_pair(elem, p));
+                    elem = p + 1;
+                }
+                break;
+            default: break;
+        }
+        ++p;
+    }
+}
+
+int parse_parallel(LeptValue& v, const char* json, size_t length, unsigned threads) {
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    const char* p = json;
+    const char* end = json + length;
+    while (p != end && is_whitespace(*p)) ++p;
+    vector<std::pair<const char*, const char*>> elems;
+    if (threads == 1 || length < kMinParallelBytes || p == end || *p != '[' || get_max_depth() == 0 ||
+        !split_elements(p, end, elems) || elems.size() < 2 * kBatch)
+        return parse(v, json, length);
+
+    v.init_array();
+    v.reserve_array(elems.size());
+    for (size_t i = 0; i < elems.size(); ++i) v.pushback_array_element(LeptValue());
+
+    std::atomic<size_t> next(0);
+    std::atomic<bool> failed(false);
+    std::exception_ptr error;
+    auto work = [&]() {
+        try {
+            size_t b;
+            while ((b = next.fetch_add(kBatch)) < elems.size()) {
+                const size_t e = std::min(b + kBatch, elems.size());
+                for (size_t i = b; i < e; ++i) {
+                    if (failed.load(std::memory_order_relaxed)) return;
+                    const char* first = elems[i].first;
+                    if (parse_nested(v.get_array_element(i), first, elems[i].second - first, 1) != PARSE_OK)
+                        failed = true;
+                }
+            }
+        } catch (...) {
+            if (!failed.exchange(true)) error = std::current_exception();
+        }
+    };
+    threads = (unsigned)std::min<size_t>(threads, (elems.size() + kBatch - 1) / kBatch);
+    vector<std::thread> pool;
+    try {
+        for (unsigned t = 1; t < threads; ++t) pool.emplace_back(work);
+    } catch (...) { /* the threads already started must be joined before unwinding */
+        failed = true;
+        for (std::thread& th : pool) th.join();
+        v.freeVal();
+        throw;
+    }
+    work(); /* the calling thread is one of the workers */
+    for (std::thread& th : pool) th.join();
+    if (error) {
+        v.freeVal();
+        std::rethrow_exception(error);
+    }
+    if (failed) return parse(v, json, length); /* the first error in input order */
+    return PARSE_OK;
+}
+
+int parse_parallel(LeptValue& v, const string& strJson, unsigned threads) {
+    return parse_parallel(v, strJson.data(), strJson.size(), threads);
+}
+
+}  // namespace lept
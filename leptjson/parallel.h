@@ -0,0 +1,20 @@
+#ifndef LEPTJSON_PARALLEL_H
+#define LEPTJSON_PARALLEL_H
+
+#include <string>
+
+#include "leptjson.h"
+
+namespace lept {
+
+/* parse() for documents whose root is a large array. A structural pre-scan splits the array at
+ * its top-level commas, then worker threads parse the elements straight into their slots. The
+ * tree and the error code are exactly those of parse(): on any error the document is parsed
+ * again serially to find the first one in input order. threads == 0 uses every core; small
+ * documents and other roots are parsed serially. */
+int parse_parallel(LeptValue& v, const char* json, size_t length, unsigned threads = 0);
+int parse_parallel(LeptValue& v, const string& strJson, unsigned threads = 0);
+
+}  // namespace lept
+
+#endif /* LEPTJSON_PARALLEL_H */
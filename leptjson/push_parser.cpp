@@ -0,0 +1,348 @@
+#include "push_parser.h"
+
+#include <cassert>
+
+#include "internal.h"
+#include "scan.h"
+
+namespace lept {
+
+namespace {
+
+/* adapts the internal DOM builder to the virtual Handler interface */
+class BuilderHandler : public Handler {
+   public:
+    explicit BuilderHandler(LeptValue& v) : builder(v, nullptr) {}
+    bool Null() override { return this->builder.Null(); }
+    bool Bool(bool b) override { return this->builder.Bool(b); }
+    bool Number(double n) override { return this->builder.Number(n); }
+    bool String(const char* s, size_t len) override { return this->builder.String(s, len); }
+    bool StartObject() override { return this->builder.StartObject(); }
+    bool Key(const char* s, size_t len) override { return this->builder.Key(s, len); }
+    bool EndObject(size_t n) override { return this->builder.EndObject(n); }
+    bool StartArray() override { return this->builder.StartArray(); }
+    bool EndArray(size_t n) override { return this->builder.EndArray(n); }
+
+   private:
+    ValueBuilder builder;
+};
+
+inline bool is_whitespace(char ch) { return ch == ' ' || ch == '\t' || ch == '\n' || ch == '\r'; }
+
+inline bool is_number_char(char ch) {
+    return (ch >= '0' && ch <= '9') || ch == '-' || ch == '+' || ch == '.' || ch == 'e' || ch == 'E';
+}
+
+inline int hex_digit(char ch) {
+    if (ch >= '0' && ch <= '9') return ch - '0';
+    if (ch >= 'A' && ch <= 'F') return ch - ('A' - 10);
+    if (ch >= 'a' && ch <= 'f') return ch - ('a' - 10);
+    return -1;
+}
+
+}  // namespace
+
+#define HANDLER_CALL(call) ((call) ? PARSE_OK : PARSE_TERMINATED)
+
+PushParser::PushParser(Handler& h) : h(&h), root(nullptr) { this->reset(); }
+
+PushParser::PushParser(LeptValue& v) : h(nullptr), root(&v) { this->reset(); }
+
+PushParser::~PushParser() {}
+
+void PushParser::reset() {
+    if (this->root) {
+        this->root->freeVal();
+        this->builder.reset(new BuilderHandler(*this->root));
+        this->h = this->builder.get();
+    }
+    this->state = VALUE;
+    this->status = PARSE_NEED_MORE;
+    this->stack.clear();
+    this->buf.clear();
+    this->high = 0;
+}
+
+int PushParser::fail(int ret) {
+    this->status = ret;
+    if (this->root) this->root->freeVal();
+    return ret;
+}
+
+int PushParser::feed(const char* data, size_t length) {
+    if (this->status != PARSE_NEED_MORE && this->status != PARSE_OK) return this->status;
+    const char* p = data;
+    const char* end = data + length;
+    while (p != end) {
+        int ret = this->step(p, end);
+        if (ret != PARSE_OK) return this->fail(ret);
+    }
+    return this->status = (this->state == DONE ? PARSE_OK : PARSE_NEED_MORE);
+}
+
+int PushParser::finish() {
+    if (this->status != PARSE_NEED_MORE && this->status != PARSE_OK) return this->status;
+    if (this->state == NUMBER) {
+        int ret = this->end_number();
+        if (ret != PARSE_OK) return this->fail(ret);
+    }
+    if (this->state != DONE) return this->fail(this->eof_status());
+    return this->status = PARSE_OK;
+}
+
+/* what parse() reports when the input stops in the current state */
+int PushParser::eof_status() const {
+    switch (this->state) {
+        case VALUE:
+        case ARRAY_FIRST: return PARSE_EXPECT_VALUE;
+        case ARRAY_NEXT: return PARSE_MISS_COMMA_OR_SQUARE_BRACKET;
+        case OBJECT_FIRST:
+        case OBJECT_KEY: return PARSE_MISS_KEY;
+        case COLON: return PARSE_MISS_COLON;
+        case OBJECT_NEXT: return PARSE_MISS_COMMA_OR_CURLY_BRACKET;
+        case STRING: return PARSE_MISS_QUOTATION_MARK;
+        case ESCAPE: return PARSE_INVALID_STRING_ESCAPE;
+        case HEX: return PARSE_INVALID_UNICODE_HEX;
+        case SURROGATE_BACKSLASH:
+        case SURROGATE_U: return PARSE_INVALID_UNICODE_SURROGATE;
+        case LITERAL: return PARSE_INVALID_VALUE;
+        default: return PARSE_OK;
+    }
+}
+
+/* consumes input from p, returns PARSE_OK while nothing went wrong */
+int PushParser::step(const char*& p, const char* end) {
+    switch (this->state) {
+        case STRING:
+        case ESCAPE:
+        case HEX:
+        case SURROGATE_BACKSLASH:
+        case SURROGATE_U: return this->string_step(p, end);
+        case LITERAL:
+            for (; p != end && this->literal[this->matched]; ++p, ++this->matched)
+                if (*p != this->literal[this->matched]) return PARSE_INVALID_VALUE;
+            if (this->literal[this->matched]) return PARSE_OK;
+            if (this->literal[0] == 'n') {
+                if (!this->h->Null()) return PARSE_TERMINATED;
+            } else if (!this->h->Bool(this->literal[0] == 't')) {
+                return PARSE_TERMINATED;
+            }
+            return this->value_done();
+        case NUMBER: {
+            const char* q = p;
+            while (q != end && is_number_char(*q)) ++q;
+            this->buf.append(p, q);
+            p = q;
+            return p == end ? PARSE_OK : this->end_number();
+        }
+        default: break;
+    }
+    while (p != end && is_whitespace(*p)) ++p;
+    if (p == end) return PARSE_OK;
+    const char ch = *p;
+    switch (this->state) {
+        case VALUE: return this->start_value(p, end);
+        case ARRAY_FIRST:
+            if (ch != ']') return this->start_value(p, end);
+            ++p;
+            this->stack.pop_back();
+            if (!this->h->EndArray(0)) return PARSE_TERMINATED;
+            return this->value_done();
+        case ARRAY_NEXT:
+            ++p;
+            if (ch == ',') {
+                this->state = VALUE;
+                return PARSE_OK;
+            }
+            if (ch != ']') return PARSE_MISS_COMMA_OR_SQUARE_BRACKET;
+            if (!this->h->EndArray(this->stack.back().count)) return PARSE_TERMINATED;
+            this->stack.pop_back();
+            return this->value_done();
+        case OBJECT_FIRST:
+            if (ch == '}') {
+                ++p;
+                this->stack.pop_back();
+                if (!this->h->EndObject(0)) return PARSE_TERMINATED;
+                return this->value_done();
+            }
+            /* fall through */
+        case OBJECT_KEY:
+            if (ch != '"') return PARSE_MISS_KEY;
+            return this->start_string(p, end, true);
+        case COLON:
+            ++p;
+            if (ch != ':') return PARSE_MISS_COLON;
+            this->state = VALUE;
+            return PARSE_OK;
+        case OBJECT_NEXT:
+            ++p;
+            if (ch == ',') {
+                this->state = OBJECT_KEY;
+                return PARSE_OK;
+            }
+            if (ch != '}') return PARSE_MISS_COMMA_OR_CURLY_BRACKET;
+            if (!this->h->EndObject(this->stack.back().count)) return PARSE_TERMINATED;
+            this->stack.pop_back();
+            return this->value_done();
+        case DONE: return PARSE_ROOT_NOT_SINGULAR;
+        default: assert(0); return PARSE_INVALID_VALUE;
+    }
+}
+
+int PushParser::start_value(const char*& p, const char* end) {
+    switch (*p) {
+        case 't': this->literal = "true"; break;
+        case 'f': this->literal = "false"; break;
+        case 'n': this->literal = "null"; break;
+        case '"': return this->start_string(p, end, false);
+        case '[':
+            if (this->stack.size() >= get_max_depth()) return PARSE_DEPTH_EXCEEDED;
+            ++p;
+            this->stack.push_back(Frame{'[', 0});
+            this->state = ARRAY_FIRST;
+            return HANDLER_CALL(this->h->StartArray());
+        case '{':
+            if (this->stack.size() >= get_max_depth()) return PARSE_DEPTH_EXCEEDED;
+            ++p;
+            this->stack.push_back(Frame{'{', 0});
+            this->state = OBJECT_FIRST;
+            return HANDLER_CALL(this->h->StartObject());
+        default:
+            if (*p != '-' && !(*p >= '0' && *p <= '9')) return PARSE_INVALID_VALUE;
+            this->buf.clear();
+            this->state = NUMBER;
+            return PARSE_OK;
+    }
+    this->matched = 0;
+    this->state = LITERAL;
+    return PARSE_OK;
+}
+
+int PushParser::start_string(const char*& p, const char* end, bool key) {
+    assert(*p == '"');
+    ++p;
+    this->isKey = key;
+    const char* q = skip_plain_chars(p, end);
+    if (q != end && *q == '"') { /* the whole string is in this chunk, pass it through */
+        const char* str = p;
+        p = q + 1;
+        if (!(key ? this->h->Key(str, q - str) : this->h->String(str, q - str)))
+            return PARSE_TERMINATED;
+        if (key) {
+            this->state = COLON;
+            return PARSE_OK;
+        }
+        return this->value_done();
+    }
+    this->buf.clear();
+    this->state = STRING;
+    return PARSE_OK;
+}
+
+int PushParser::string_step(const char*& p, const char* end) {
+    string& s = this->buf;
+    while (p != end) {
+        switch (this->state) {
+            case STRING: {
+                const char* q = skip_plain_chars(p, end);
+                s.append(p, q);
+                p = q;
+                if (p == end) return PARSE_OK;
+                const char ch = *p++;
+                if (ch == '"') return this->end_string();
+                if (ch != '\\') return PARSE_INVALID_STRING_CHAR;
+                this->state = ESCAPE;
+                break;
+            }
+            case ESCAPE:
+                this->state = STRING;
+                switch (*p++) {
+                    case '"': s += '"'; break;
+                    case '\\': s += '\\'; break;
+                    case '/': s += '/'; break;
+                    case 'b': s += '\b'; break;
+                    case 'f': s += '\f'; break;
+                    case 'n': s += '\n'; break;
+                    case 'r': s += '\r'; break;
+                    case 't': s += '\t'; break;
+                    case 'u':
+                        this->hex = this->hexCount = 0;
+                        this->state = HEX;
+                        break;
+                    default: return PARSE_INVALID_STRING_ESCAPE;
+                }
+                break;
+            case HEX: {
+                const int d = hex_digit(*p++);
+                if (d < 0) return PARSE_INVALID_UNICODE_HEX;
+                this->hex = this->hex << 4 | d;
+                if (++this->hexCount < 4) break;
+                unsigned u = this->hex;
+                if (this->high) {
+                    if (u < 0xDC00 || u > 0xDFFF) return PARSE_INVALID_UNICODE_SURROGATE;
+                    u = (((this->high - 0xD800) << 10) | (u - 0xDC00)) + 0x10000;
+                    this->high = 0;
+                } else if (u >= 0xD800 && u <= 0xDBFF) { /* surrogate pair */
+                    this->high = u;
+                    this->state = SURROGATE_BACKSLASH;
+                    break;
+                }
+                encode_utf8(s, u);
+                this->state = STRING;
+                break;
+            }
+            case SURROGATE_BACKSLASH:
+                if (*p++ != '\\') return PARSE_INVALID_UNICODE_SURROGATE;
+                this->state = SURROGATE_U;
+                break;
+            case SURROGATE_U:
+                if (*p++ != 'u') return PARSE_INVALID_UNICODE_SURROGATE;
+                this->hex = this->hexCount = 0;
+                this->state = HEX;
+                break;
+            default: assert(0); return PARSE_INVALID_VALUE;
+        }
+    }
+    return PARSE_OK;
+}
+
+int PushParser::end_string() {
+    if (this->isKey) {
+        this->state = COLON;
+        return HANDLER_CALL(this->h->Key(this->buf.data(), this->buf.size()));
+    }
+    if (!this->h->String(this->buf.data(), this->buf.size())) return PARSE_TERMINATED;
+    return this->value_done();
+}
+
+/* the number text ended at a delimiter or at end of input */
+int PushParser::end_number() {
+    const char* first = this->buf.data();
+    const char* last = first + this->buf.size();
+    const char* stop;
+    double n;
+    int ret = parse_number_span(first, last, n, stop);
+    if (ret != PARSE_OK) return ret;
+    if (!this->h->RawNumber(first, stop - first, n)) return PARSE_TERMINATED;
+    if ((ret = this->value_done()) != PARSE_OK) return ret;
+    if (stop != last) { /* "0123": parse() stops after the 0 and rejects what follows */
+        const string rest(stop, last);
+        const char* p = rest.data();
+        while (p != rest.data() + rest.size())
+            if ((ret = this->step(p, rest.data() + rest.size())) != PARSE_OK) return ret;
+    }
+    return PARSE_OK;
+}
+
+int PushParser::value_done() {
+    if (this->stack.empty()) {
+        this->state = DONE;
+        return PARSE_OK;
+    }
+    Frame& top = this->stack.back();
+    ++top.count;
+    this->state = top.kind == '[' ? ARRAY_NEXT : OBJECT_NEXT;
+    return PARSE_OK;
+}
+
+}  // namespace lept
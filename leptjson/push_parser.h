@@ -0,0 +1,85 @@
+#ifndef LEPTJSON_PUSH_PARSER_H
+#define LEPTJSON_PUSH_PARSER_H
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "leptjson.h"
+
+namespace lept {
+
+/* Resumable parser for input that arrives in chunks. The state lives in the object instead of
+ * on the call stack, so feed() can stop anywhere, even inside a string or a number, and go on
+ * with the next chunk. Errors match parse() on the concatenated input.
+ *
+ *   PushParser p(v);
+ *   while (read(buf)) if ((ret = p.feed(buf, n)) != PARSE_NEED_MORE) break;
+ *   if (ret == PARSE_NEED_MORE) ret = p.finish();
+ */
+class PushParser {
+   public:
+    explicit PushParser(Handler& h);
+    explicit PushParser(LeptValue& v); /* builds the tree into v, v is NONE after an error */
+    ~PushParser();
+    PushParser(const PushParser&) = delete;
+    PushParser& operator=(const PushParser&) = delete;
+
+    /* PARSE_NEED_MORE until the root value is complete, then PARSE_OK, or an error code.
+     * A root number is only complete at a delimiter or at finish(). Errors are sticky. */
+    int feed(const char* data, size_t length);
+    int feed(const string& data) { return this->feed(data.data(), data.size()); }
+    /* marks the end of input and returns the final status */
+    int finish();
+    /* starts over for a new document, keeping the buffers */
+    void reset();
+
+   private:
+    enum State {
+        VALUE,        /* a value must come next */
+        ARRAY_FIRST,  /* after '[' */
+        ARRAY_NEXT,   /* after an element */
+        OBJECT_FIRST, /* after '{' */
+        OBJECT_KEY,   /* after ',' in an object */
+        COLON,        /* after a key */
+        OBJECT_NEXT,  /* after a member value */
+        DONE,         /* root complete, only whitespace may follow */
+        STRING,       /* inside a string */
+        ESCAPE,       /* after '\' */
+        HEX,          /* inside \uXXXX */
+        SURROGATE_BACKSLASH,
+        SURROGATE_U,
+        LITERAL,      /* inside true, false or null */
+        NUMBER        /* inside a number */
+    };
+    struct Frame {
+        char kind; /* '[' or '{' */
+        size_t count;
+    };
+    int step(const char*& p, const char* end);
+    int start_value(const char*& p, const char* end);
+    int start_string(const char*& p, const char* end, bool key);
+    int string_step(const char*& p, const char* end);
+    int end_string();
+    int end_number();
+    int value_done();
+    int eof_status() const;
+    int fail(int ret);
+
+    Handler* h;
+    std::unique_ptr<Handler> builder; /* owned DOM handler when parsing into a LeptValue */
+    LeptValue* root;
+    State state;
+    int status;
+    vector<Frame> stack;
+    string buf;              /* partial string or number */
+    bool isKey;              /* the current string is an object key */
+    const char* literal;     /* the literal being matched */
+    size_t matched;          /* chars of it seen so far */
+    unsigned hex, hexCount;  /* hex digits of the current \u escape */
+    unsigned high;           /* pending high surrogate, 0 if none */
+};
+
+}  // namespace lept
+
+#endif /* LEPTJSON_PUSH_PARSER_H */
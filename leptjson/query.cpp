@@ -0,0 +1,341 @@
+#include "query.h"
+
+#include <algorithm>
+#include <cassert>
+
+#include "internal.h"
+
+namespace lept {
+
+static const size_t npos = (size_t)-1;
+
+bool Pointer::compile(const string& text) {
+    this->tokens.clear();
+    if (text.empty()) return true; /* the whole document */
+    if (text[0] != '/') return false;
+    for (size_t i = 1;; ++i) { /* i is just past a '/' */
+        Token t;
+        for (; i < text.size() && text[i] != '/'; ++i) {
+            if (text[i] != '~') {
+                t.key += text[i];
+            } else if (i + 1 < text.size() && (text[i + 1] == '0' || text[i + 1] == '1')) {
+                t.key += text[++i] == '0' ? '~' : '/';
+            } else {
+                return false;
+            }
+        }
+        /* array indices are 0 or digits without a leading zero */
+        t.index = npos;
+        const string& k = t.key;
+        if (!k.empty() && k.size() <= 18 && (k == "0" || k[0] != '0') &&
+            std::all_of(k.begin(), k.end(), [](char ch) { return ch >= '0' && ch <= '9'; }))
+            t.index = std::stoull(k);
+        this->tokens.push_back(std::move(t));
+        if (i >= text.size()) return true;
+    }
+}
+
+const LeptValue* Pointer::get(const LeptValue& root) const {
+    const LeptValue* v = &root;
+    for (const Token& t : this->tokens) {
+        if (v->get_type() == OBJECT) {
+            v = v->get_object_value(t.key);
+            if (v == nullptr) return nullptr;
+        } else if (v->get_type() == ARRAY) {
+            if (t.index >= v->get_array_size()) return nullptr; /* also "-" and non-numbers */
+            v = &v->get_array_element(t.index);
+        } else {
+            return nullptr;
+        }
+    }
+    return v;
+}
+
+LeptValue* Pointer::get(LeptValue& root) const {
+    return const_cast<LeptValue*>(this->get(static_cast<const LeptValue&>(root)));
+}
+
+static bool parse_integer(const char*& p, long long& n) {
+    bool neg = *p == '-';
+    if (neg) ++p;
+    if (*p < '0' || *p > '9') return false;
+    n = 0;
+    for (; *p >= '0' && *p <= '9'; ++p)
+        if (n < (1LL << 53)) n = n * 10 + (*p - '0');
+    if (neg) n = -n;
+    return true;
+}
+
+/* p is just past '[', leaves p past the ']' */
+bool Path::parse_bracket(const char*& p, Step& s) {
+    if (*p == '*') {
+        s.kind = WILDCARD;
+        ++p;
+    } else if (*p == '\'' || *p == '"') {
+        const char quote = *p++;
+        s.kind = NAME;
+        for (; *p != quote; ++p) {
+            if (*p == '\0') return false;
+            if (*p == '\\' && (p[1] == quote || p[1] == '\\')) ++p;
+            s.name += *p;
+        }
+        ++p;
+    } else {
+        s.hasStart = parse_integer(p, s.start);
+        if (*p != ':') {
+            if (!s.hasStart) return false;
+            s.kind = INDEX;
+            s.index = s.start;
+        } else {
+            s.kind = SLICE;
+            ++p;
+            s.hasEnd = parse_integer(p, s.end);
+            if (*p == ':') {
+                ++p;
+                if (parse_integer(p, s.step) && s.step <= 0) return false;
+            }
+        }
+    }
+    return *p++ == ']';
+}
+
+bool Path::compile(const string& text) {
+    this->steps.clear();
+    const char* p = text.c_str();
+    if (*p++ != '$') return false;
+    while (*p) {
+        Step s{NAME, false, string(), 0, 0, 0, 1, false, false};
+        if (*p == '[') {
+            if (!parse_bracket(++p, s)) return false;
+        } else if (*p == '.') {
+            if (*++p == '.') {
+                s.recursive = true;
+                if (*++p == '[') {
+                    if (!parse_bracket(++p, s)) return false;
+                    this->steps.push_back(std::move(s));
+                    continue;
+                }
+            }
+            if (*p == '*') {
+                s.kind = WILDCARD;
+                ++p;
+            } else {
+                const char* q = p;
+                while (*q && *q != '.' && *q != '[') ++q;
+                if (q == p) return false;
+                s.name.assign(p, q);
+                p = q;
+            }
+        } else {
+            return false;
+        }
+        this->steps.push_back(std::move(s));
+    }
+    return p == text.c_str() + text.size(); /* no embedded NUL */
+}
+
+bool Path::match_index(const Step& s, size_t i, size_t len) {
+    if (s.kind == WILDCARD) return true;
+    if (s.kind == INDEX) {
+        if (s.index >= 0) return i == (size_t)s.index;
+        return len != npos && (long long)len + s.index >= 0 && i == len + s.index;
+    }
+    if (s.kind != SLICE) return false;
+    long long start = s.hasStart ? s.start : 0;
+    long long end = s.hasEnd ? s.end : (1LL << 62);
+    if (start < 0 || end < 0) { /* counted from the end */
+        if (len == npos) return false;
+        if (start < 0) start = std::max(0LL, (long long)len + start);
+        if (end < 0) end = (long long)len + end;
+    }
+    const long long n = (long long)i;
+    return n >= start && n < end && (n - start) % s.step == 0;
+}
+
+/* states are the numbers of steps matched on the way to v, over all routes through .. steps */
+void Path::visit(const LeptValue& v, const vector<size_t>& states,
+                 vector<const LeptValue*>& out) const {
+    const size_t n = this->steps.size();
+    if (std::find(states.begin(), states.end(), n) != states.end()) out.push_back(&v);
+    const e_types type = v.get_type();
+    if (type != ARRAY && type != OBJECT) return;
+
+    /* one plain name or index: look the child up instead of walking them all */
+    if (states.size() == 1 && states[0] < n && !this->steps[states[0]].recursive) {
+        const Step& s = this->steps[states[0]];
+        const vector<size_t> next(1, states[0] + 1);
+        if (s.kind == NAME) {
+            if (type == OBJECT) {
+                const LeptValue* child = v.get_object_value(s.name);
+                if (child) this->visit(*child, next, out);
+            }
+            return;
+        }
+        if (s.kind == INDEX) {
+            if (type == ARRAY) {
+                const size_t len = v.get_array_size();
+                const size_t i = s.index >= 0 ? (size_t)s.index : len + s.index;
+                if (i < len) this->visit(v.get_array_element(i), next, out);
+            }
+            return;
+        }
+    }
+
+    const size_t count = type == ARRAY ? v.get_array_size() : v.get_object_size();
+    vector<size_t> next;
+    for (size_t i = 0; i < count; ++i) {
+        next.clear();
+        for (size_t k : states) {
+            if (k == n) continue;
+            const Step& s = this->steps[k];
+            bool hit = type == ARRAY ? match_index(s, i, count)
+                                     : s.kind == WILDCARD || (s.kind == NAME && s.name == v.get_object_key(i));
+            if (hit && std::find(next.begin(), next.end(), k + 1) == next.end()) next.push_back(k + 1);
+            if (s.recursive && std::find(next.begin(), next.end(), k) == next.end()) next.push_back(k);
+        }
+        if (!next.empty())
+            this->visit(type == ARRAY ? v.get_array_element(i) : v.get_object_value(i), next, out);
+    }
+}
+
+void Path::select(const LeptValue& root, vector<const LeptValue*>& out) const {
+    this->visit(root, vector<size_t>(1, 0), out);
+}
+
+struct PathStream::Capture {
+    Capture(size_t path, size_t depth) : path(path), builder(value, nullptr), depth(depth), done(false) {}
+    size_t path;
+    LeptValue value; /* declared before the builder that fills it */
+    ValueBuilder builder;
+    size_t depth; /* containers open when it started */
+    bool done;
+};
+
+PathStream::PathStream(const vector<const Path*>& paths, Callback fn)
+    : paths(paths), fn(std::move(fn)), stopped(false) {}
+
+PathStream::~PathStream() {}
+
+void PathStream::reset() {
+    this->pool.clear();
+    this->stack.clear();
+    this->captures.clear();
+    this->stopped = false;
+}
+
+void PathStream::enter() {
+    const size_t begin = this->pool.size();
+    if (this->stack.empty()) {
+        for (size_t p = 0; p < this->paths.size(); ++p) this->pool.push_back(State{p, 0});
+    } else {
+        const Frame& f = this->stack.back();
+        for (size_t i = f.states; i < begin; ++i) {
+            const State st = this->pool[i];
+            const vector<Path::Step>& steps = this->paths[st.path]->steps;
+            if (st.step == steps.size()) continue;
+            const Path::Step& s = steps[st.step];
+            bool hit = f.object ? s.kind == Path::WILDCARD || (s.kind == Path::NAME && s.name == this->key)
+                                : Path::match_index(s, f.index, npos);
+            for (int pass = 0; pass < 2; ++pass) {
+                const State add{st.path, pass ? st.step : st.step + 1};
+                if (!(pass ? s.recursive : hit)) continue;
+                bool seen = false;
+                for (size_t j = begin; j < this->pool.size() && !seen; ++j)
+                    seen = this->pool[j].path == add.path && this->pool[j].step == add.step;
+                if (!seen) this->pool.push_back(add);
+            }
+        }
+    }
+    for (size_t i = begin; i < this->pool.size(); ++i) {
+        const State st = this->pool[i];
+        if (st.step == this->paths[st.path]->steps.size())
+            this->captures.emplace_back(new Capture(st.path, this->stack.size()));
+    }
+}
+
+template <class Fn>
+bool PathStream::forward(Fn fn) {
+    for (auto& c : this->captures)
+        if (!c->done) fn(c->builder);
+    return true;
+}
+
+bool PathStream::leave() {
+    for (auto& c : this->captures)
+        if (!c->done && c->depth == this->stack.size()) c->done = true;
+    if (!this->stack.empty()) ++this->stack.back().index;
+    size_t i = 0;
+    for (; i < this->captures.size() && this->captures[i]->done && !this->stopped; ++i)
+        if (!this->fn(this->captures[i]->path, this->captures[i]->value)) this->stopped = true;
+    this->captures.erase(this->captures.begin(), this->captures.begin() + i);
+    return !this->stopped;
+}
+
+bool PathStream::Null() {
+    const size_t begin = this->pool.size();
+    this->enter();
+    this->forward([](ValueBuilder& b) { return b.Null(); });
+    this->pool.resize(begin);
+    return this->leave();
+}
+
+bool PathStream::Bool(bool v) {
+    const size_t begin = this->pool.size();
+    this->enter();
+    this->forward([v](ValueBuilder& b) { return b.Bool(v); });
+    this->pool.resize(begin);
+    return this->leave();
+}
+
+bool PathStream::Number(double n) {
+    const size_t begin = this->pool.size();
+    this->enter();
+    this->forward([n](ValueBuilder& b) { return b.Number(n); });
+    this->pool.resize(begin);
+    return this->leave();
+}
+
+bool PathStream::String(const char* s, size_t len) {
+    const size_t begin = this->pool.size();
+    this->enter();
+    this->forward([s, len](ValueBuilder& b) { return b.String(s, len); });
+    this->pool.resize(begin);
+    return this->leave();
+}
+
+bool PathStream::StartObject() {
+    const size_t begin = this->pool.size();
+    this->enter();
+    this->forward([](ValueBuilder& b) { return b.StartObject(); });
+    this->stack.push_back(Frame{begin, 0, true});
+    return true;
+}
+
+bool PathStream::Key(const char* s, size_t len) {
+    this->key.assign(s, len);
+    return this->forward([s, len](ValueBuilder& b) { return b.Key(s, len); });
+}
+
+bool PathStream::EndObject(size_t n) {
+    this->forward([n](ValueBuilder& b) { return b.EndObject(n); });
+    this->pool.resize(this->stack.back().states);
+    this->stack.pop_back();
+    return this->leave();
+}
+
+bool PathStream::StartArray() {
+    const size_t begin = this->pool.size();
+    this->enter();
+    this->forward([](ValueBuilder& b) { return b.StartArray(); });
+    this->stack.push_back(Frame{begin, 0, false});
+    return true;
+}
+
+bool PathStream::EndArray(size_t n) {
+    this->forward([n](ValueBuilder& b) { return b.EndArray(n); });
+    this->pool.resize(this->stack.back().states);
+    this->stack.pop_back();
+    return this->leave();
+}
+
+}  // namespace lept
@@ -0,0 +1,105 @@
+#ifndef LEPTJSON_QUERY_H
+#define LEPTJSON_QUERY_H
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "leptjson.h"
+
+namespace lept {
+
+/* RFC 6901 JSON Pointer, e.g. "/a/0/b~1c". Compile once, resolve against many documents. */
+class Pointer {
+   public:
+    /* false if text is not a valid pointer */
+    bool compile(const string& text);
+    /* the value the pointer refers to, or nullptr */
+    const LeptValue* get(const LeptValue& root) const;
+    LeptValue* get(LeptValue& root) const;
+
+   private:
+    struct Token {
+        string key;
+        size_t index; /* the key as an array index, npos if it is not one */
+    };
+    vector<Token> tokens;
+};
+
+/* JSONPath subset: $, .name, ['name'], [n], [*], .*, ..name, ..*, ..[n] and slices [start:end:step]
+ * with a positive step. Matches are returned once each, in document order. */
+class Path {
+   public:
+    /* false on a syntax error */
+    bool compile(const string& text);
+    void select(const LeptValue& root, vector<const LeptValue*>& out) const;
+
+   private:
+    friend class PathStream;
+    enum Kind { NAME, INDEX, SLICE, WILDCARD };
+    struct Step {
+        Kind kind;
+        bool recursive; /* .. applies the selector at any depth below */
+        string name;
+        long long index, start, end, step;
+        bool hasStart, hasEnd;
+    };
+    /* len is the array size, or npos when it is not known yet */
+    static bool match_index(const Step& s, size_t i, size_t len);
+    void visit(const LeptValue& v, const vector<size_t>& states, vector<const LeptValue*>& out) const;
+    static bool parse_bracket(const char*& p, Step& s);
+
+    vector<Step> steps;
+};
+
+/* Evaluates paths over the SAX events of parse(Handler&, ...) without building the document.
+ * Only matched values are built, and each is passed to the callback with the index of its path
+ * once it is complete, in document order. Negative indices need the array size and never match
+ * here. Call reset() before reusing it after a failed parse. */
+class PathStream : public Handler {
+   public:
+    /* return false to stop the parse */
+    typedef std::function<bool(size_t path, const LeptValue& v)> Callback;
+    PathStream(const vector<const Path*>& paths, Callback fn);
+    ~PathStream() override;
+    void reset();
+
+    bool Null() override;
+    bool Bool(bool b) override;
+    bool Number(double n) override;
+    bool String(const char* s, size_t len) override;
+    bool StartObject() override;
+    bool Key(const char* s, size_t len) override;
+    bool EndObject(size_t n) override;
+    bool StartArray() override;
+    bool EndArray(size_t n) override;
+
+   private:
+    struct State {
+        size_t path;
+        size_t step; /* steps already matched */
+    };
+    struct Frame {
+        size_t states; /* first of this container's states in the pool */
+        size_t index;  /* next element index */
+        bool object;
+    };
+    struct Capture;
+    void enter(); /* a value starts: works out its states and opens captures */
+    template <class Fn>
+    bool forward(Fn fn);
+    bool leave(); /* a value ended: delivers finished captures */
+
+    vector<const Path*> paths;
+    Callback fn;
+    vector<State> pool;  /* states of every open container, then of the current value */
+    vector<Frame> stack;
+    string key;
+    vector<std::unique_ptr<Capture>> captures; /* in the order they started */
+    bool stopped;
+};
+
+}  // namespace lept
+
+#endif /* LEPTJSON_QUERY_H */
@@ -0,0 +1,111 @@
+#include "scan.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || \
+    defined(__SSE2__)
+#define LEPT_SSE2 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+namespace lept {
+
+namespace {
+
+inline bool is_special(char ch) { return (unsigned char)ch < 0x20 || ch == '"' || ch == '\\'; }
+
+const char* skip_plain_chars_scalar(const char* p, const char* end) {
+    while (p != end && !is_special(*p)) ++p;
+    return p;
+}
+
+#ifdef LEPT_SSE2
+
+inline int lowest_bit(unsigned mask) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return (int)index;
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+
+const char* skip_plain_chars_sse2(const char* p, const char* end) {
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i control = _mm_set1_epi8(0x1F);
+    while (end - p >= 16) {
+        const __m128i x = _mm_loadu_si128((const __m128i*)p);
+        /* min(x, 0x1F) == x  <=>  x <= 0x1F as unsigned */
+        const __m128i m = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(x, quote), _mm_cmpeq_epi8(x, backslash)),
+            _mm_cmpeq_epi8(_mm_min_epu8(x, control), x));
+        const unsigned mask = (unsigned)_mm_movemask_epi8(m);
+        if (mask) return p + lowest_bit(mask);
+        p += 16;
+    }
+    return skip_plain_chars_scalar(p, end);
+}
+
+#if defined(__GNUC__) || defined(__clang__)
+#define LEPT_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define LEPT_TARGET_AVX2
+#endif
+
+LEPT_TARGET_AVX2 const char* skip_plain_chars_avx2(const char* p, const char* end) {
+    const __m256i quote = _mm256_set1_epi8('"');
+    const __m256i backslash = _mm256_set1_epi8('\\');
+    const __m256i control = _mm256_set1_epi8(0x1F);
+    while (end - p >= 32) {
+        const __m256i x = _mm256_loadu_si256((const __m256i*)p);
+        const __m256i m = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(x, quote), _mm256_cmpeq_epi8(x, backslash)),
+            _mm256_cmpeq_epi8(_mm256_min_epu8(x, control), x));
+        const unsigned mask = (unsigned)_mm256_movemask_epi8(m);
+        if (mask) return p + lowest_bit(mask);
+        p += 32;
+    }
+    return skip_plain_chars_sse2(p, end);
+}
+
+bool cpu_has_avx2() {
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) return false;
+    __cpuid(info, 1);
+    const bool osxsave = (info[2] & (1 << 27)) != 0;
+    if (!osxsave || (_xgetbv(0) & 6) != 6) return false; /* OS saves the YMM registers */
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#elif defined(__GNUC__) || defined(__clang__)
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") != 0;
+#else
+    return false;
+#endif
+}
+
+#endif /* LEPT_SSE2 */
+
+typedef const char* (*skip_fn)(const char*, const char*);
+
+skip_fn select_skip_plain_chars() {
+#ifdef LEPT_SSE2
+    return cpu_has_avx2() ? skip_plain_chars_avx2 : skip_plain_chars_sse2;
+#else
+    return skip_plain_chars_scalar;
+#endif
+}
+
+}  // namespace
+
+const char* skip_plain_chars(const char* p, const char* end) {
+    static const skip_fn fn = select_skip_plain_chars();
+    return fn(p, end);
+}
+
+}  // namespace lept
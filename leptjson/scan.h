@@ -0,0 +1,12 @@
+#ifndef LEPTJSON_SCAN_H
+#define LEPTJSON_SCAN_H
+
+namespace lept {
+
+/* returns the first byte in [p, end) that is '"', '\\' or a control char (< 0x20), or end.
+ * Uses AVX2 or SSE2 when the CPU has it, picked once at runtime. */
+const char* skip_plain_chars(const char* p, const char* end);
+
+}  // namespace lept
+
+#endif /* LEPTJSON_SCAN_H */
@@ -0,0 +1,267 @@
+#include "tape.h"
+
+#include <cassert>
+#include <cstring>
+
+namespace lept {
+
+static const int kTagShift = 56;
+static const uint64_t kPayloadMask = ((uint64_t)1 << kTagShift) - 1;
+
+static inline uint64_t make_word(char tag, uint64_t payload) {
+    return (uint64_t)(unsigned char)tag << kTagShift | payload;
+}
+
+static inline char tag_of(uint64_t w) { return (char)(w >> kTagShift); }
+
+static inline size_t payload_of(uint64_t w) { return (size_t)(w & kPayloadMask); }
+
+/* the position just past the value at pos */
+static inline size_t next_value(const vector<uint64_t>& tape, size_t pos) {
+    switch (tag_of(tape[pos])) {
+        case '[':
+        case '{': return payload_of(tape[pos]);
+        case 'd':
+        case 's': return pos + 2;
+        default: return pos + 1;
+    }
+}
+
+/* appends tape words for SAX events, from the parser or from a LeptValue */
+class TapeBuilder : public Handler {
+   public:
+    explicit TapeBuilder(Tape& t) : t(t) {}
+    bool Null() override { return this->scalar('n'); }
+    bool Bool(bool b) override { return this->scalar(b ? 't' : 'f'); }
+    bool Number(double n) override {
+        uint64_t bits;
+        memcpy(&bits, &n, 8);
+        this->t.tape.push_back(make_word('d', 0));
+        this->t.tape.push_back(bits);
+        return true;
+    }
+    bool String(const char* s, size_t len) override {
+        if (this->t.insitu) { /* the parser left s in the buffer, decoded and terminated */
+            this->t.tape.push_back(make_word('s', s - this->t.insitu));
+            this->t.tape.push_back(len);
+            return true;
+        }
+        this->t.tape.push_back(make_word('s', this->t.strings.size()));
+        this->t.tape.push_back(len);
+        this->t.strings.append(s, len);
+        this->t.strings += '\0';
+        return true;
+    }
+    bool Key(const char* s, size_t len) override { return this->String(s, len); }
+    bool StartObject() override { return this->open('{'); }
+    bool EndObject(size_t n) override { return this->close('}', n); }
+    bool StartArray() override { return this->open('['); }
+    bool EndArray(size_t n) override { return this->close(']', n); }
+
+    void value(const LeptValue& v) {
+        size_t i;
+        switch (v.get_type()) {
+            case NONE: this->Null(); break;
+            case FALSE: this->Bool(false); break;
+            case TRUE: this->Bool(true); break;
+            case NUMBER: this->Number(v.get_number()); break;
+            case STRING: this->String(v.get_string(), v.get_string_length()); break;
+            case ARRAY:
+                this->open('[');
+                for (i = 0; i < v.get_array_size(); ++i) this->value(v.get_array_element(i));
+                this->close(']', i);
+                break;
+            case OBJECT:
+                this->open('{');
+                for (i = 0; i < v.get_object_size(); ++i) {
+                    this->String(v.get_object_key(i).data(), v.get_object_key_length(i));
+                    this->value(v.get_object_value(i));
+                }
+                this->close('}', i);
+                break;
+            default: throw "Invalid value type";
+        }
+    }
+
+   private:
+    bool scalar(char tag) {
+        this->t.tape.push_back(make_word(tag, 0));
+        return true;
+    }
+    bool open(char tag) {
+        this->open_at.push_back(this->t.tape.size());
+        this->t.tape.push_back(make_word(tag, 0)); /* patched by close() */
+        this->t.tape.push_back(0);
+        return true;
+    }
+    bool close(char tag, size_t count) {
+        const size_t start = this->open_at.back();
+        this->open_at.pop_back();
+        this->t.tape.push_back(make_word(tag, start));
+        this->t.tape[start] |= this->t.tape.size();
+        this->t.tape[start + 1] = count;
+        return true;
+    }
+
+    Tape& t;
+    vector<size_t> open_at;
+};
+
+int Tape::build(const char* json, size_t length, char* insitu) {
+    this->tape.clear();
+    this->strings.clear();
+    this->insitu = insitu;
+    TapeBuilder b(*this);
+    int ret = insitu ? lept::parse_insitu(b, insitu, length) : lept::parse(b, json, length);
+    if (ret != PARSE_OK) {
+        this->tape.clear();
+        this->strings.clear();
+        this->insitu = nullptr;
+    }
+    return ret;
+}
+
+int Tape::parse(const char* json, size_t length) { return this->build(json, length, nullptr); }
+
+int Tape::parse_insitu(char* json, size_t length) { return this->build(json, length, json); }
+
+void Tape::assign(const LeptValue& v) {
+    this->tape.clear();
+    this->strings.clear();
+    this->insitu = nullptr;
+    TapeBuilder(*this).value(v);
+}
+
+uint64_t TapeValue::word() const {
+    assert(this->tape != nullptr);
+    return this->tape->tape[this->pos];
+}
+
+e_types TapeValue::get_type() const {
+    switch (tag_of(this->word())) {
+        case 't': return TRUE;
+        case 'f': return FALSE;
+        case 'd': return NUMBER;
+        case 's': return STRING;
+        case '[': return ARRAY;
+        case '{': return OBJECT;
+        default: return NONE;
+    }
+}
+
+bool TapeValue::get_boolean() const {
+    assert(this->get_type() == TRUE || this->get_type() == FALSE);
+    return tag_of(this->word()) == 't';
+}
+
+double TapeValue::get_number() const {
+    assert(this->get_type() == NUMBER);
+    double n;
+    memcpy(&n, &this->tape->tape[this->pos + 1], 8);
+    return n;
+}
+
+const char* TapeValue::get_string() const {
+    assert(this->get_type() == STRING);
+    return this->tape->text() + payload_of(this->word());
+}
+
+size_t TapeValue::get_string_length() const {
+    assert(this->get_type() == STRING);
+    return (size_t)this->tape->tape[this->pos + 1];
+}
+
+size_t TapeValue::child(size_t index) const {
+    const vector<uint64_t>& t = this->tape->tape;
+    size_t i = 0, p = this->pos + 2;
+    const uint64_t last = this->cursor.load(std::memory_order_relaxed);
+    if (index >= (size_t)(last >> 32)) {
+        i = (size_t)(last >> 32);
+        p = this->pos + (uint32_t)last;
+    }
+    const bool object = tag_of(t[this->pos]) == '{';
+    for (; i < index; ++i) {
+        if (object) p += 2; /* the key */
+        p = next_value(t, p);
+    }
+    if (index <= UINT32_MAX && p - this->pos <= UINT32_MAX) /* else not worth a wider word */
+        this->cursor.store((uint64_t)index << 32 | (p - this->pos), std::memory_order_relaxed);
+    return p;
+}
+
+size_t TapeValue::get_array_size() const {
+    assert(this->get_type() == ARRAY);
+    return (size_t)this->tape->tape[this->pos + 1];
+}
+
+TapeValue TapeValue::get_array_element(size_t index) const {
+    assert(index < this->get_array_size());
+    return TapeValue(this->tape, this->child(index));
+}
+
+size_t TapeValue::get_object_size() const {
+    assert(this->get_type() == OBJECT);
+    return (size_t)this->tape->tape[this->pos + 1];
+}
+
+const char* TapeValue::get_object_key(size_t index) const {
+    assert(index < this->get_object_size());
+    return TapeValue(this->tape, this->child(index)).get_string();
+}
+
+size_t TapeValue::get_object_key_length(size_t index) const {
+    assert(index < this->get_object_size());
+    return TapeValue(this->tape, this->child(index)).get_string_length();
+}
+
+TapeValue TapeValue::get_object_value(size_t index) const {
+    assert(index < this->get_object_size());
+    return TapeValue(this->tape, this->child(index) + 2);
+}
+
+TapeValue TapeValue::get_object_value(const string& key) const {
+    assert(this->get_type() == OBJECT);
+    const vector<uint64_t>& t = this->tape->tape;
+    const size_t end = payload_of(this->word()) - 1; /* the '}' */
+    for (size_t p = this->pos + 2; p < end; p = next_value(t, p + 2)) {
+        const TapeValue k(this->tape, p);
+        if (k.get_string_length() == key.size() && memcmp(k.get_string(), key.data(), key.size()) == 0)
+            return TapeValue(this->tape, p + 2);
+    }
+    return TapeValue();
+}
+
+void TapeValue::get_value(LeptValue& v) const {
+    const vector<uint64_t>& t = this->tape->tape;
+    switch (tag_of(this->word())) {
+        case 'n': v.freeVal(); break;
+        case 't': v.set_boolean(true); break;
+        case 'f': v.set_boolean(false); break;
+        case 'd': v.set_number(this->get_number()); break;
+        case 's': v.set_string(this->get_string(), this->get_string_length()); break;
+        case '[': {
+            const size_t n = this->get_array_size();
+            v.init_array();
+            v.reserve_array(n);
+            for (size_t i = 0, p = this->pos + 2; i < n; ++i, p = next_value(t, p)) {
+                v.pushback_array_element(LeptValue());
+                TapeValue(this->tape, p).get_value(v.get_array_element(i));
+            }
+            break;
+        }
+        case '{': {
+            const size_t n = this->get_object_size();
+            v.init_object();
+            v.reserve_object(n);
+            for (size_t i = 0, p = this->pos + 2; i < n; ++i, p = next_value(t, p + 2)) {
+                const TapeValue k(this->tape, p);
+                v.pushback_object_member(string(k.get_string(), k.get_string_length()), LeptValue());
+                TapeValue(this->tape, p + 2).get_value(v.get_object_value(i));
+            }
+            break;
+        }
+        default: assert(0);
+    }
+}
+
+}  // namespace lept
@@ -0,0 +1,100 @@
+#ifndef LEPTJSON_TAPE_H
+#define LEPTJSON_TAPE_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "leptjson.h"
+
+namespace lept {
+
+class Tape;
+
+/* Read-only handle to a value on a Tape, with the getters of LeptValue. A handle from a failed
+ * lookup is empty and converts to false. Finding a child walks the ones before it, starting from
+ * the last child this handle found, so a loop over the indices stays linear. That cursor is one
+ * relaxed atomic word, so threads may share a handle; they then only move each other's cursor. */
+class TapeValue {
+   public:
+    TapeValue() : tape(nullptr), pos(0), cursor(0) {}
+    TapeValue(const TapeValue& rhs)
+        : tape(rhs.tape), pos(rhs.pos), cursor(rhs.cursor.load(std::memory_order_relaxed)) {}
+    TapeValue& operator=(const TapeValue& rhs) {
+        this->tape = rhs.tape;
+        this->pos = rhs.pos;
+        this->cursor.store(rhs.cursor.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        return *this;
+    }
+    explicit operator bool() const { return this->tape != nullptr; }
+
+    e_types get_type() const;
+    bool get_boolean() const;
+    double get_number() const;
+    const char* get_string() const; /* NUL-terminated, may contain NULs */
+    size_t get_string_length() const;
+
+    size_t get_array_size() const;
+    TapeValue get_array_element(size_t index) const;
+    size_t get_object_size() const;
+    const char* get_object_key(size_t index) const;
+    size_t get_object_key_length(size_t index) const;
+    TapeValue get_object_value(size_t index) const;
+    TapeValue get_object_value(const string& key) const;
+
+    /* copies the subtree into a LeptValue */
+    void get_value(LeptValue& v) const;
+
+   private:
+    friend class Tape;
+    TapeValue(const Tape* tape, size_t pos) : tape(tape), pos(pos), cursor(2) {}
+    uint64_t word() const;
+    size_t child(size_t index) const; /* tape position of the index-th child */
+
+    const Tape* tape;
+    size_t pos;
+    /* a child found before: its index in the high half, its distance from pos in the low */
+    mutable std::atomic<uint64_t> cursor;
+};
+
+/* Immutable document in two flat arrays. Each value is one or two 64-bit words, the tag in the
+ * top byte and a payload below:
+ *   'n' 't' 'f'  null, true, false
+ *   'd'          number, the next word holds the double's bits
+ *   's'          string, payload is its offset in the string buffer, the next word its length
+ *   '[' '{'      payload is the position just past the container, so it can be skipped in one
+ *                step; the next word is the element or member count. Members are a key
+ *                string followed by the value.
+ *   ']' '}'      payload is the position of the opening word
+ * String bytes are stored back to back, each followed by a NUL. After parse_insitu the offsets
+ * are into the parsed buffer instead, where the parser has written the NULs. */
+class Tape {
+   public:
+    Tape() = default;
+    /* builds the tape straight from the parser's events, no LeptValue is created */
+    int parse(const char* json, size_t length);
+    int parse(const string& strJson) { return this->parse(strJson.data(), strJson.size()); }
+    /* parses json in situ and leaves the strings there instead of copying them to the string
+     * buffer, json must then outlive the tape */
+    int parse_insitu(char* json, size_t length);
+    void assign(const LeptValue& v);
+    TapeValue get_root() const { return this->tape.empty() ? TapeValue() : TapeValue(this, 0); }
+    size_t get_tape_size() const { return this->tape.size(); }
+    size_t get_string_buffer_size() const { return this->strings.size(); }
+
+   private:
+    friend class TapeValue;
+    friend class TapeBuilder;
+
+    const char* text() const { return this->insitu ? this->insitu : this->strings.data(); }
+    int build(const char* json, size_t length, char* insitu);
+
+    vector<uint64_t> tape;
+    string strings;
+    const char* insitu = nullptr; /* the parsed buffer when the strings are still in it */
+};
+
+}  // namespace lept
+
+#endif /* LEPTJSON_TAPE_H */
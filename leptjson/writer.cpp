@@ -0,0 +1,105 @@
+#include "writer.h"
+
+#include <cerrno>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+namespace lept {
+
+StringWriter::StringWriter(string& s) : s(s), base(s.size()) {
+    this->s.resize(this->base + 256);
+    this->cur = &this->s[this->base];
+    this->end = &this->s[0] + this->s.size();
+}
+
+bool StringWriter::flush() {
+    size_t used = this->cur - this->s.data();
+    this->s.resize(used);
+    this->cur = this->end = &this->s[0] + used; /* the next write grows it again */
+    return true;
+}
+
+void StringWriter::overflow(const char* data, size_t n) {
+    size_t used = this->cur - this->s.data();
+    size_t size = this->s.size() * 2;
+    if (size < used + n) size = used + n;
+    this->s.resize(size);
+    memcpy(&this->s[used], data, n);
+    this->cur = &this->s[used + n];
+    this->end = &this->s[0] + size;
+}
+
+BufferedWriter::BufferedWriter(size_t bufferSize) : buf(bufferSize ? bufferSize : 1) {
+    this->cur = this->buf.data();
+    this->end = this->buf.data() + this->buf.size();
+}
+
+bool BufferedWriter::flush() {
+    size_t len = this->cur - this->buf.data();
+    this->cur = this->buf.data();
+    if (this->ok && len) this->ok = this->send(this->buf.data(), len);
+    return this->ok;
+}
+
+void BufferedWriter::overflow(const char* s, size_t n) {
+    size_t len = this->cur - this->buf.data();
+    this->cur = this->buf.data();
+    if (!this->ok) return;
+    if (n >= this->buf.size()) { /* too big to buffer, send both pieces at once */
+        this->ok = len ? this->send_gather(this->buf.data(), len, s, n) : this->send(s, n);
+        return;
+    }
+    if (len) this->ok = this->send(this->buf.data(), len);
+    memcpy(this->cur, s, n);
+    this->cur += n;
+}
+
+bool FdWriter::send(const char* data, size_t len) {
+    while (len) {
+#ifdef _WIN32
+        int r = _write(this->fd, data, len > 0x40000000 ? 0x40000000 : (unsigned)len);
+#else
+        ssize_t r = ::write(this->fd, data, len);
+#endif
+        if (r < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += r;
+        len -= r;
+    }
+    return true;
+}
+
+bool FdWriter::send_gather(const char* a, size_t alen, const char* b, size_t blen) {
+#ifdef _WIN32
+    return this->send(a, alen) && this->send(b, blen);
+#else
+    while (alen) {
+        struct iovec iov[2] = {{(void*)a, alen}, {(void*)b, blen}};
+        ssize_t r = ::writev(this->fd, iov, 2);
+        if (r < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        if ((size_t)r < alen) {
+            a += r;
+            alen -= r;
+        } else { /* the first piece is out, the rest of the second goes through send() */
+            b += r - alen;
+            blen -= r - alen;
+            alen = 0;
+        }
+    }
+    return this->send(b, blen);
+#endif
+}
+
+bool FileWriter::send(const char* data, size_t len) { return fwrite(data, 1, len, this->fp) == len; }
+
+}  // namespace lept
@@ -0,0 +1,135 @@
+#ifndef LEPTJSON_WRITER_H
+#define LEPTJSON_WRITER_H
+
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "leptjson.h"
+
+namespace lept {
+
+/* Output target for stringify. Bytes go into [cur, end) and overflow() is called when they do
+ * not fit, so the per-byte path never makes a virtual call. */
+class Writer {
+   public:
+    virtual ~Writer() {}
+    void put(char ch) {
+        if (this->cur != this->end)
+            *this->cur++ = ch;
+        else
+            this->overflow(&ch, 1);
+    }
+    void write(const char* s, size_t n) {
+        if ((size_t)(this->end - this->cur) >= n) {
+            memcpy(this->cur, s, n);
+            this->cur += n;
+        } else {
+            this->overflow(s, n);
+        }
+    }
+    size_t room() const { return this->end - this->cur; }
+    char* pos() { return this->cur; }     /* direct access for up to room() bytes */
+    void advance(char* p) { this->cur = p; }
+    /* hands everything written so far to the sink, false if the sink failed */
+    virtual bool flush() { return this->ok; }
+    bool good() const { return this->ok; }
+
+   protected:
+    Writer() : cur(nullptr), end(nullptr), ok(true) {}
+    /* takes s[0, n) that did not fit, and makes new room */
+    virtual void overflow(const char* s, size_t n) = 0;
+    char* cur;
+    char* end;
+    bool ok;
+};
+
+/* writes into a string, growing it as needed */
+class StringWriter : public Writer {
+   public:
+    explicit StringWriter(string& s);
+    ~StringWriter() override { this->flush(); }
+    bool flush() override; /* trims s to the written length */
+
+   protected:
+    void overflow(const char* s, size_t n) override;
+
+   private:
+    string& s;
+    size_t base;
+};
+
+/* Fixed-size buffer in front of a sink, memory use does not depend on the document size. After
+ * a sink error good() is false and further output is dropped. */
+class BufferedWriter : public Writer {
+   public:
+    ~BufferedWriter() override {}
+    bool flush() override;
+
+   protected:
+    explicit BufferedWriter(size_t bufferSize);
+    void overflow(const char* s, size_t n) override;
+    virtual bool send(const char* data, size_t len) = 0;
+    /* sends two pieces in order, sinks that can gather override this */
+    virtual bool send_gather(const char* a, size_t alen, const char* b, size_t blen) {
+        return this->send(a, alen) && this->send(b, blen);
+    }
+
+   private:
+    vector<char> buf;
+};
+
+/* write()/writev() to a file descriptor, retrying short writes and EINTR */
+class FdWriter : public BufferedWriter {
+   public:
+    explicit FdWriter(int fd, size_t bufferSize = 64 * 1024) : BufferedWriter(bufferSize), fd(fd) {}
+    ~FdWriter() override { this->flush(); }
+
+   protected:
+    bool send(const char* data, size_t len) override;
+    bool send_gather(const char* a, size_t alen, const char* b, size_t blen) override;
+
+   private:
+    int fd;
+};
+
+/* fwrite() to a FILE*, the stream is not closed */
+class FileWriter : public BufferedWriter {
+   public:
+    explicit FileWriter(FILE* fp, size_t bufferSize = 64 * 1024) : BufferedWriter(bufferSize), fp(fp) {}
+    ~FileWriter() override { this->flush(); }
+
+   protected:
+    bool send(const char* data, size_t len) override;
+
+   private:
+    FILE* fp;
+};
+
+/* passes each full buffer to a callback, which returns false to stop */
+class CallbackWriter : public BufferedWriter {
+   public:
+    typedef std::function<bool(const char*, size_t)> Callback;
+    explicit CallbackWriter(Callback fn, size_t bufferSize = 64 * 1024)
+        : BufferedWriter(bufferSize), fn(std::move(fn)) {}
+    ~CallbackWriter() override { this->flush(); }
+
+   protected:
+    bool send(const char* data, size_t len) override { return this->fn(data, len); }
+
+   private:
+    Callback fn;
+};
+
+/* the pieces stringify is made of: a quoted, escaped string and a shortest round-trip number */
+void write_string(Writer& w, const char* s, size_t length);
+void write_number(Writer& w, double n);
+
+/* streams v to w and flushes it, false if the sink failed */
+bool stringify(const LeptValue& v, Writer& w);
+
+}  // namespace lept
+
+#endif /* LEPTJSON_WRITER_H */
@@ -1,9 +1,26 @@
 // #include <cstdlib>
+#include <cmath>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
 #include <iomanip>
 #include <iostream>
+#include <limits>
+#include <random>
+#include <stdexcept>
 #include <string>
+#include <thread>
 
+#include "leptjson/binary.h"
+#include "leptjson/bind.h"
+#include "leptjson/lazy.h"
 #include "leptjson/leptjson.h"
+#include "leptjson/lines.h"
+#include "leptjson/parallel.h"
+#include "leptjson/push_parser.h"
+#include "leptjson/query.h"
+#include "leptjson/tape.h"
+#include "leptjson/writer.h"
 
 namespace lept {
 using std::cerr;
@@ -28,10 +45,11 @@ static int test_pass = 0;
 
 #define EXPECT_EQ_INT(expect, actual) EXPECT_EQ_BASE((expect) == (actual), expect, actual, 0)
 #define EXPECT_EQ_DOUBLE(expect, actual) EXPECT_EQ_BASE((expect) == (actual), expect, actual, 17)
-#define EXPECT_EQ_STRING(expect, actual, alength)                                                \
-    EXPECT_EQ_BASE(                                                                              \
-        sizeof(expect) - 1 == (alength) && string(expect, sizeof(expect) - 1) == actual, expect, \
-        actual, 0)
+static const char* text_of(const char* s) { return s; }
+static const char* text_of(const string& s) { return s.data(); }
+#define EXPECT_EQ_STRING(expect, actual, alength)                                                    \
+    EXPECT_EQ_BASE(sizeof(expect) - 1 == (alength) && memcmp(expect, text_of(actual), alength) == 0, \
+                   expect, actual, 0)
 #define EXPECT_TRUE(actual) EXPECT_EQ_BASE((actual) != 0, "true", "false", 0)
 #define EXPECT_FALSE(actual) EXPECT_EQ_BASE((actual) == 0, "false", "true", 0)
 
@@ -46,7 +64,7 @@ static int test_pass = 0;
 static void test_parse_null() {
     LeptValue v;
     v.freeVal();
-    v.set_type(FALSE);
+    v.set_boolean(false);
     EXPECT_EQ_INT(PARSE_OK, parse(v, " null"));
     EXPECT_EQ_INT(NONE, v.get_type());
     v.freeVal();
@@ -55,7 +73,7 @@ static void test_parse_null() {
 static void test_parse_true() {
     LeptValue v;
     v.freeVal();
-    v.set_type(FALSE);
+    v.set_boolean(false);
     EXPECT_EQ_INT(PARSE_OK, parse(v, "true "));
     EXPECT_EQ_INT(TRUE, v.get_type());
     v.freeVal();
@@ -64,7 +82,7 @@ static void test_parse_true() {
 static void test_parse_false() {
     LeptValue v;
     v.freeVal();
-    v.set_type(TRUE);
+    v.set_boolean(true);
     EXPECT_EQ_INT(PARSE_OK, parse(v, "false"));
     EXPECT_EQ_INT(FALSE, v.get_type());
     v.freeVal();
@@ -101,10 +119,23 @@ static void test_parse_number() {
     TEST_NUMBER(1.234E-10, "1.234E-10");
 
     TEST_NUMBER(1.0000000000000002, "1.0000000000000002");            /* the smallest number > 1 */
+    TEST_NUMBER(4.9406564584124654e-324, "4.9406564584124654e-324");  // minimum denormal
+    TEST_NUMBER(-4.9406564584124654e-324, "-4.9406564584124654e-324");
+    TEST_NUMBER(2.2250738585072009e-308, "2.2250738585072009e-308");  // max subnormal
+    TEST_NUMBER(-2.2250738585072009e-308, "-2.2250738585072009e-308");
     TEST_NUMBER(2.2250738585072014e-308, "2.2250738585072014e-308");  // min normal
     TEST_NUMBER(-2.2250738585072014e-308, "-2.2250738585072014e-308");
     TEST_NUMBER(1.7976931348623157e+308, "1.7976931348623157e+308");  // max
     TEST_NUMBER(-1.7976931348623157e+308, "-1.7976931348623157e+308");
+
+    /* past the fast path: long mantissas and exponents beyond 1e22 */
+    TEST_NUMBER(1e30, "1e30");
+    TEST_NUMBER(4.528486461847799e+49, "4.528486461847799e+49");
+    TEST_NUMBER(0.001, "0.001");
+    TEST_NUMBER(9007199254740993.0, "9007199254740993");
+    TEST_NUMBER(1.2345678901234568e+29, "123456789012345678901234567890");
+    TEST_NUMBER(0.1, "0.1000000000000000055511151231257827021181583404541015625");
+    TEST_NUMBER(0.0, "0e-10000");
 }
 
 #define TEST_STRING(expect, json)                                        \
@@ -130,6 +161,21 @@ static void test_parse_string() {
     TEST_STRING("\xF0\x9D\x84\x9E", "\"\\ud834\\udd1e\""); /* G clef sign U+1D11E */
 }
 
+/* long runs go through the vectorized scanner, put the special char at every block offset */
+static void test_parse_string_long() {
+    for (size_t i = 0; i < 80; ++i) {
+        string plain(i, 'a'), tail(37, '\xE4');
+        LeptValue v;
+        EXPECT_EQ_INT(PARSE_OK, parse(v, "\"" + plain + "\\n" + tail + "\""));
+        EXPECT_TRUE(v.get_type() == STRING && string(v.get_string(), v.get_string_length()) == plain + "\n" + tail);
+        EXPECT_EQ_INT(PARSE_OK, parse(v, "\"" + plain + tail + "\\\"\""));
+        EXPECT_TRUE(v.get_type() == STRING && string(v.get_string(), v.get_string_length()) == plain + tail + "\"");
+        EXPECT_EQ_INT(PARSE_INVALID_STRING_CHAR, parse(v, "\"" + plain + "\x1F" + tail + "\""));
+        EXPECT_EQ_INT(PARSE_INVALID_STRING_CHAR, parse(v, "\"" + plain + '\0' + "\""));
+        EXPECT_EQ_INT(PARSE_MISS_QUOTATION_MARK, parse(v, "\"" + plain + tail));
+    }
+}
+
 static void test_parse_array() {
     size_t i, j;
     LeptValue v;
@@ -234,7 +280,7 @@ static void test_parse_object() {
     do {                                      \
         LeptValue v;                          \
         v.freeVal();                          \
-        v.set_type(FALSE);                    \
+        v.set_boolean(false);                 \
         EXPECT_EQ_INT(error, parse(v, json)); \
         EXPECT_EQ_INT(NONE, v.get_type());    \
         v.freeVal();                          \
@@ -274,6 +320,8 @@ static void test_parse_number_too_big() {
     TEST_ERROR(PARSE_NUMBER_TOO_BIG, "1e309");
     TEST_ERROR(PARSE_NUMBER_TOO_BIG, "-1e309");
     TEST_ERROR(PARSE_NUMBER_TOO_BIG, "1e-10000"); /* must underflow */
+    TEST_ERROR(PARSE_NUMBER_TOO_BIG, "1.8e308");
+    TEST_ERROR(PARSE_NUMBER_TOO_BIG, "1e99999999999999999999");
 }
 
 static void test_parse_missing_quotation_mark() {
@@ -347,12 +395,682 @@ static void test_parse_miss_comma_or_curly_bracket() {
     TEST_ERROR(PARSE_MISS_COMMA_OR_CURLY_BRACKET, "{\"a\":{}");
 }
 
+static void test_parse_buffer() {
+    LeptValue v;
+    /* not NUL-terminated: every read must stay inside [json, json + length) */
+    const char num[] = {'1', '2', '3'};
+    EXPECT_EQ_INT(PARSE_OK, parse(v, num, sizeof(num)));
+    EXPECT_EQ_DOUBLE(123.0, v.get_number());
+
+    const char* json = "[1,\"ab\"]trailing";
+    EXPECT_EQ_INT(PARSE_OK, parse(v, json, 8));
+    EXPECT_EQ_INT(ARRAY, v.get_type());
+    EXPECT_EQ_SIZE_T(2, v.get_array_size());
+    EXPECT_EQ_STRING("ab", v.get_array_element(1).get_string(),
+                     v.get_array_element(1).get_string_length());
+    EXPECT_EQ_INT(PARSE_ROOT_NOT_SINGULAR, parse(v, json, 9));
+    EXPECT_EQ_INT(NONE, v.get_type());
+
+    EXPECT_EQ_INT(PARSE_INVALID_VALUE, parse(v, "true", 3));
+    EXPECT_EQ_INT(PARSE_INVALID_VALUE, parse(v, "1.5", 2));
+    EXPECT_EQ_INT(PARSE_MISS_QUOTATION_MARK, parse(v, "\"abc\"", 4));
+    EXPECT_EQ_INT(PARSE_INVALID_UNICODE_HEX, parse(v, "\"\\u0041\"", 6));
+    EXPECT_EQ_INT(PARSE_MISS_COMMA_OR_SQUARE_BRACKET, parse(v, "[1]", 2));
+    EXPECT_EQ_INT(PARSE_MISS_COLON, parse(v, "{\"a\":1}", 4));
+    EXPECT_EQ_INT(PARSE_EXPECT_VALUE, parse(v, "", 0));
+    EXPECT_EQ_INT(PARSE_EXPECT_VALUE, parse(v, nullptr, 0));
+}
+
+static void test_parse_document() {
+    LeptValue copy, moved;
+    vector<LeptValue> taken;
+    {
+        Document doc;
+        EXPECT_EQ_INT(PARSE_OK, doc.parse("{\"a\":[1,2,{\"b\":\"a string longer than SSO\"}],\"c\":[]}"));
+        const LeptValue& root = doc.get_root();
+        EXPECT_EQ_INT(OBJECT, root.get_type());
+        EXPECT_EQ_SIZE_T(3, root.get_object_value(0).get_array_size());
+        EXPECT_TRUE(doc.get_arena().allocated() > 0);
+        copy = root.get_object_value(0); /* copies go to the heap */
+
+        doc.get_root().get_object_value(1).pushback_array_element(copy);
+        EXPECT_EQ_SIZE_T(1, root.get_object_value(1).get_array_size());
+
+        EXPECT_EQ_INT(PARSE_MISS_COMMA_OR_SQUARE_BRACKET, doc.parse("[1,2"));
+        EXPECT_EQ_INT(NONE, doc.get_root().get_type());
+        EXPECT_EQ_INT(PARSE_OK, doc.parse("[[[]]]"));
+        EXPECT_EQ_SIZE_T(1, doc.get_root().get_array_element(0).get_array_size());
+
+        /* moving out copies to the heap, moves inside the tree stay in the arena */
+        EXPECT_EQ_INT(PARSE_OK, doc.parse("[\"a string longer than SSO\",{\"k\":[1]},2,3]"));
+        LeptValue& a = doc.get_root();
+        a.insert_array_element(LeptValue(), 0);
+        a.erase_array_element(0, 1);
+        taken.push_back(std::move(a.get_array_element(0)));
+        taken.push_back(std::move(a.get_array_element(1)));
+        moved = std::move(a);
+    }
+    EXPECT_TRUE(stringify(moved, nullptr) == "[\"a string longer than SSO\",{\"k\":[1]},2,3]");
+    EXPECT_EQ_STRING("a string longer than SSO", taken[0].get_string(), taken[0].get_string_length());
+    EXPECT_TRUE(stringify(taken[1], nullptr) == "{\"k\":[1]}");
+    EXPECT_EQ_INT(ARRAY, copy.get_type());
+    EXPECT_EQ_STRING("a string longer than SSO",
+                     copy.get_array_element(2).get_object_value(0).get_string(),
+                     copy.get_array_element(2).get_object_value(0).get_string_length());
+
+    Arena arena(64);
+    void* p = arena.allocate(1000, 16);
+    EXPECT_TRUE(p != nullptr && ((uintptr_t)p & 15) == 0);
+    EXPECT_EQ_SIZE_T(1000, arena.allocated());
+    arena.reset();
+    EXPECT_EQ_SIZE_T(0, arena.allocated());
+}
+
+static void test_parse_reuse() {
+    const char* docs[] = {
+        "[{\"id\":1,\"name\":\"a string longer than SSO\",\"tags\":[1,2,3]},{\"id\":2}]",
+        "[{\"id\":3,\"name\":\"another long-ish string\",\"tags\":[4,5]},{\"id\":4,\"x\":null}]",
+        "[{\"id\":\"5\",\"tags\":{\"k\":[]},\"name\":true},7,[]]",
+        "{\"id\":1}",
+        "[]",
+        "\"s\"",
+    };
+    LeptValue v, expect;
+    for (const char* json : docs) {
+        EXPECT_EQ_INT(PARSE_OK, parse_reuse(v, json));
+        parse(expect, json);
+        EXPECT_TRUE(stringify(v, nullptr) == stringify(expect, nullptr));
+    }
+
+    /* same shape again: the old containers and string buffers are refilled */
+    EXPECT_EQ_INT(PARSE_OK, parse_reuse(v, docs[0]));
+    const LeptValue* first = &v.get_array_element(0);
+    const char* name = first->get_object_value(1).get_string();
+    EXPECT_EQ_INT(PARSE_OK, parse_reuse(v, docs[1]));
+    EXPECT_TRUE(first == &v.get_array_element(0));
+    EXPECT_TRUE(name == first->get_object_value(1).get_string());
+    EXPECT_EQ_SIZE_T(2, first->get_object_value("tags")->get_array_size());
+    EXPECT_EQ_SIZE_T(KEY_NOT_EXIST, v.get_array_element(1).get_object_index("name"));
+    EXPECT_EQ_SIZE_T(1, v.get_array_element(1).get_object_index("x"));
+
+    string big = "{";
+    for (size_t i = 0; i < 100; ++i) big += "\"" + std::to_string(i) + "\":" + std::to_string(i) + ",";
+    big.back() = '}';
+    EXPECT_EQ_INT(PARSE_OK, parse_reuse(v, big));
+    EXPECT_TRUE(v.has_object_index());
+    big.replace(big.find("\"42\""), 4, "\"xy\"");
+    EXPECT_EQ_INT(PARSE_OK, parse_reuse(v, big));
+    EXPECT_EQ_SIZE_T(42, v.get_object_index("xy"));
+    EXPECT_EQ_SIZE_T(KEY_NOT_EXIST, v.get_object_index("42"));
+    EXPECT_EQ_INT(PARSE_OK, parse_reuse(v, "{\"0\":0,\"1\":1}"));
+    EXPECT_FALSE(v.has_object_index());
+    EXPECT_EQ_SIZE_T(1, v.get_object_index("1"));
+
+    EXPECT_EQ_INT(PARSE_MISS_COMMA_OR_SQUARE_BRACKET, parse_reuse(v, "[1,2"));
+    EXPECT_EQ_INT(NONE, v.get_type());
+}
+
+static void test_parse_intern_keys() {
+    KeyPool keys;
+    LeptValue v;
+    const char* json = "[{\"id\":1,\"name\":\"a\"},{\"id\":2,\"name\":\"b\"},{\"name\":\"c\",\"id\":3}]";
+    EXPECT_EQ_INT(PARSE_OK, parse(v, json, strlen(json), &keys));
+    EXPECT_EQ_SIZE_T(2, keys.size());
+    const LeptValue& first = v.get_array_element(0);
+    const LeptValue& last = v.get_array_element(2);
+    EXPECT_TRUE(&first.get_object_key(0) == &last.get_object_key(1)); /* one string per distinct key */
+    EXPECT_EQ_SIZE_T(1, last.get_object_index("id"));
+    EXPECT_EQ_SIZE_T(KEY_NOT_EXIST, last.get_object_index("missing"));
+    EXPECT_EQ_DOUBLE(3.0, last.get_object_value("id")->get_number());
+    size_t length;
+    string out = stringify(v, &length);
+    EXPECT_TRUE(out == json);
+
+    LeptValue copy(last); /* copies own their keys */
+    v.get_array_element(2).remove_object_member(0);
+    v.get_array_element(2).pushback_object_member("extra", LeptValue());
+    EXPECT_EQ_SIZE_T(3, keys.size());
+    EXPECT_EQ_SIZE_T(0, v.get_array_element(2).get_object_index("id"));
+    EXPECT_EQ_SIZE_T(1, v.get_array_element(2).get_object_index("extra"));
+    EXPECT_EQ_SIZE_T(0, copy.get_object_index("name"));
+    EXPECT_TRUE(&copy.get_object_key(0) != &first.get_object_key(1));
+
+    string big = "{";
+    for (size_t i = 0; i < 100; ++i) big += "\"" + std::to_string(i) + "\":" + std::to_string(i) + ",";
+    big.back() = '}';
+    {
+        Document doc;
+        doc.set_key_pool(&keys);
+        EXPECT_EQ_INT(PARSE_OK, doc.parse(big));
+        LeptValue& root = doc.get_root();
+        EXPECT_TRUE(root.has_object_index());
+        EXPECT_EQ_SIZE_T(42, root.get_object_index("42"));
+        root.remove_object_member(0);
+        EXPECT_EQ_SIZE_T(41, root.get_object_index("42"));
+        EXPECT_EQ_SIZE_T(KEY_NOT_EXIST, root.get_object_index("0"));
+        root.shrink_object();
+        root.clear_object();
+        root.shrink_object();
+        root.pushback_object_member("id", LeptValue());
+        EXPECT_EQ_SIZE_T(0, root.get_object_index("id"));
+    }
+    EXPECT_EQ_SIZE_T(103, keys.size());
+}
+
+/* writes every SAX event as one letter, stops after `limit` events */
+class EventRecorder : public Handler {
+   public:
+    explicit EventRecorder(size_t limit = (size_t)-1) : limit(limit) {}
+    bool Null() override { return this->add("n"); }
+    bool Bool(bool b) override { return this->add(b ? "t" : "f"); }
+    bool Number(double d) override { return this->add("#" + std::to_string((int)d)); }
+    bool String(const char* s, size_t len) override { return this->add("s:" + string(s, len)); }
+    bool StartObject() override { return this->add("{"); }
+    bool Key(const char* s, size_t len) override { return this->add("k:" + string(s, len)); }
+    bool EndObject(size_t n) override { return this->add("}" + std::to_string(n)); }
+    bool StartArray() override { return this->add("["); }
+    bool EndArray(size_t n) override { return this->add("]" + std::to_string(n)); }
+    string events;
+
+   private:
+    bool add(const string& e) {
+        this->events += e + ' ';
+        return --this->limit > 0;
+    }
+    size_t limit;
+};
+
+static void test_parse_sax() {
+    EventRecorder rec;
+    EXPECT_EQ_INT(PARSE_OK,
+                  parse(rec, " { \"a\" : [ null , true , false , 12 , \"x\\ty\" ] , \"b\" : { } } "));
+    EXPECT_TRUE(rec.events == "{ k:a [ n t f #12 s:x\ty ]5 k:b { }0 }2 ");
+
+    EventRecorder stop(3);
+    EXPECT_EQ_INT(PARSE_TERMINATED, parse(stop, "[1,2,3,4]"));
+    EXPECT_TRUE(stop.events == "[ #1 #2 ");
+
+    /* errors come from the same code path as the DOM parser */
+    const char* bad[] = {"[1,2", "{\"a\" 1}", "\"\\x\"", "[1] x", "", "{\"a\":1,}"};
+    for (const char* json : bad) {
+        EventRecorder r;
+        LeptValue v;
+        EXPECT_EQ_INT(parse(v, json), parse(r, json));
+    }
+}
+
+/* keeps what String and Key point at, the text stays in the parsed buffer */
+class TextCollector : public Handler {
+   public:
+    bool String(const char* s, size_t len) override { return this->add(s, len); }
+    bool Key(const char* s, size_t len) override { return this->add(s, len); }
+    vector<const char*> text;
+    vector<size_t> length;
+
+   private:
+    bool add(const char* s, size_t len) {
+        this->text.push_back(s);
+        this->length.push_back(len);
+        return true;
+    }
+};
+
+static void test_parse_insitu() {
+    char json[] = "{\"plain\":\"abc\",\"esc\\n\":\"a\\u00e9\\\"\\uD834\\uDD1Ez\",\"e\":\"\"}";
+    const char* const first = json;
+    const char* const last = json + sizeof(json) - 1;
+    TextCollector c;
+    EXPECT_EQ_INT(PARSE_OK, parse_insitu(c, json, sizeof(json) - 1));
+    EXPECT_EQ_SIZE_T(6, c.text.size());
+    bool inside = true;
+    for (const char* t : c.text) inside = inside && t >= first && t < last;
+    EXPECT_TRUE(inside);
+    EXPECT_EQ_STRING("plain", c.text[0], c.length[0]);
+    EXPECT_EQ_STRING("abc", c.text[1], c.length[1]);
+    EXPECT_EQ_STRING("esc\n", c.text[2], c.length[2]);
+    EXPECT_EQ_STRING("a\xC3\xA9\"\xF0\x9D\x84\x9Ez", c.text[3], c.length[3]);
+    EXPECT_EQ_STRING("", c.text[5], c.length[5]);
+    bool terminated = true;
+    for (size_t i = 0; i < c.text.size(); ++i) terminated = terminated && c.text[i][c.length[i]] == '\0';
+    EXPECT_TRUE(terminated);
+
+    /* errors are the same as for parse() */
+    const char* bad[] = {"[\"a\\x\"]", "[\"abc", "{\"a\" 1}", "[\"\\uD800\"]"};
+    for (const char* b : bad) {
+        string text(b), copy(b);
+        TextCollector r;
+        EventRecorder e;
+        EXPECT_EQ_INT(parse(e, copy), parse_insitu(r, &text[0], text.size()));
+    }
+
+    /* the DOM keeps its strings in the buffer, copies and new text are its own */
+    char dom[] = "[\"a long string in the buffer\",\"x\\ty\",{\"key\":\"v\"}]";
+    LeptValue v;
+    EXPECT_EQ_INT(PARSE_OK, parse_insitu(v, dom, sizeof(dom) - 1));
+    const LeptValue& s = v.get_array_element(0);
+    EXPECT_TRUE(s.get_string() >= dom && s.get_string() < dom + sizeof(dom));
+    EXPECT_EQ_STRING("a long string in the buffer", s.get_string(), s.get_string_length());
+    EXPECT_EQ_STRING("x\ty", v.get_array_element(1).get_string(), v.get_array_element(1).get_string_length());
+    EXPECT_EQ_STRING("v", v.get_array_element(2).get_object_value(0).get_string(), 1);
+    LeptValue copy(s);
+    EXPECT_TRUE(copy.get_string() < dom || copy.get_string() >= dom + sizeof(dom));
+    EXPECT_EQ_STRING("a long string in the buffer", copy.get_string(), copy.get_string_length());
+    v.get_array_element(1).set_string("a string too long to be short", 29);
+    EXPECT_EQ_STRING("x\ty", dom + 32, 3);
+    EXPECT_EQ_STRING("[\"a long string in the buffer\",\"a string too long to be short\",{\"key\":\"v\"}]",
+                     stringify(v, nullptr).c_str(), stringify(v, nullptr).size());
+    char broken[] = "[\"abc\\x\"]";
+    EXPECT_EQ_INT(PARSE_INVALID_STRING_ESCAPE, parse_insitu(v, broken, sizeof(broken) - 1));
+    EXPECT_EQ_INT(NONE, v.get_type());
+
+    char text[] = "{\"name\":\"the arena holds none of this text\"}";
+    Document d;
+    EXPECT_EQ_INT(PARSE_OK, d.parse_insitu(text, sizeof(text) - 1));
+    const LeptValue& name = d.get_root().get_object_value(0);
+    EXPECT_TRUE(name.get_string() >= text && name.get_string() < text + sizeof(text));
+    LeptValue moved(std::move(d.get_root()));
+    EXPECT_EQ_STRING("the arena holds none of this text", moved.get_object_value(0).get_string(),
+                     moved.get_object_value(0).get_string_length());
+}
+
+/* feeds json split at every position, and one byte at a time */
+static void test_push_split(const string& json) {
+    LeptValue expect;
+    const int ret = parse(expect, json);
+    const string out = ret == PARSE_OK ? stringify(expect, nullptr) : string();
+    for (size_t cut = 0; cut <= json.size() + 1; ++cut) {
+        LeptValue v;
+        PushParser p(v);
+        int r = PARSE_NEED_MORE;
+        if (cut <= json.size()) {
+            r = p.feed(json.data(), cut);
+            if (r == PARSE_NEED_MORE || r == PARSE_OK) r = p.feed(json.data() + cut, json.size() - cut);
+        } else {
+            for (size_t i = 0; i < json.size() && (r == PARSE_NEED_MORE || r == PARSE_OK); ++i)
+                r = p.feed(json.data() + i, 1);
+        }
+        if (r == PARSE_NEED_MORE || r == PARSE_OK) r = p.finish();
+        EXPECT_EQ_INT(ret, r);
+        if (ret == PARSE_OK) {
+            const string got = stringify(v, nullptr);
+            EXPECT_EQ_BASE(out == got, out, got, 0);
+        } else {
+            EXPECT_EQ_INT(NONE, v.get_type());
+        }
+    }
+}
+
+static void test_parse_push() {
+    const char* cases[] = {
+        "null", " true ", "false", "0", "-0.0", "1.5e+10", "123", "0123", "1.", "1e309", "-",
+        "\"\"", "\"Hello\\nWorld\"", "\"\\u00A2\\u20AC\\uD834\\uDD1E\"", "\"abc", "\"\\x\"",
+        "\"\\u12G4\"", "\"\\uD800\\uE000\"", "\"\\uD800x\"", "\"\x01\"", "tru", "nul", "fals x",
+        "[]", "[ null , false , true , 123 , \"abc\" ]", "[[[]],[1,[2]]]", "[1,2", "[1 2]", "[1,]",
+        "{}", " { \"n\" : null , \"a\" : [ 1, 2, 3 ], \"o\" : { \"1\" : 1, \"2\" : {} } } ",
+        "{\"a\":1,}", "{\"a\" 1}", "{1:1}", "{\"a\":1 \"b\":2}", "{\"a\"", "[0x0]", "[1]x", "", " "};
+    for (const char* json : cases) test_push_split(json);
+
+    /* SAX output and callbacks across chunks */
+    EventRecorder rec;
+    PushParser p(rec);
+    EXPECT_EQ_INT(PARSE_NEED_MORE, p.feed("{\"ke"));
+    EXPECT_EQ_INT(PARSE_NEED_MORE, p.feed("y\":[12"));
+    EXPECT_EQ_INT(PARSE_NEED_MORE, p.feed("3,\"a\\"));
+    EXPECT_EQ_INT(PARSE_OK, p.feed("tb\"]} "));
+    EXPECT_EQ_INT(PARSE_OK, p.finish());
+    EXPECT_TRUE(rec.events == "{ k:key [ #123 s:a\tb ]2 }1 ");
+
+    /* a root number needs a delimiter or finish() */
+    LeptValue v;
+    PushParser num(v);
+    EXPECT_EQ_INT(PARSE_NEED_MORE, num.feed("12"));
+    EXPECT_EQ_INT(PARSE_OK, num.finish());
+    EXPECT_EQ_DOUBLE(12.0, v.get_number());
+    num.reset();
+    EXPECT_EQ_INT(PARSE_NEED_MORE, num.feed("[\"x"));
+    EXPECT_EQ_INT(PARSE_MISS_QUOTATION_MARK, num.finish());
+    EXPECT_EQ_INT(PARSE_MISS_QUOTATION_MARK, num.feed("\"]")); /* sticky */
+    EXPECT_EQ_INT(NONE, v.get_type());
+
+    EventRecorder stop(2);
+    PushParser sp(stop);
+    EXPECT_EQ_INT(PARSE_TERMINATED, sp.feed("[1,2,3]"));
+}
+
+static void test_parse_file() {
+    const char* path = "leptjson_test_file.json";
+    const string json = "{\"a\":[1,2,\"plain\",\"esc\\n\"],\"b\":{\"c\":null}}";
+    FILE* fp = fopen(path, "wb");
+    EXPECT_TRUE(fp != nullptr);
+    if (fp == nullptr) return;
+    fwrite(json.data(), 1, json.size(), fp);
+    fclose(fp);
+
+    LeptValue v;
+    EXPECT_EQ_INT(PARSE_OK, parse_file(v, path));
+    EXPECT_EQ_STRING("{\"a\":[1,2,\"plain\",\"esc\\n\"],\"b\":{\"c\":null}}", stringify(v, nullptr),
+                     stringify(v, nullptr).size());
+    EventRecorder rec;
+    EXPECT_EQ_INT(PARSE_OK, parse_file(rec, path));
+    EXPECT_TRUE(rec.events == "{ k:a [ #1 #2 s:plain s:esc\n ]4 k:b { k:c n }1 }2 ");
+    Document doc;
+    EXPECT_EQ_INT(PARSE_OK, doc.parse_file(path));
+    EXPECT_EQ_SIZE_T(2, doc.get_root().get_object_size());
+
+    fp = fopen(path, "wb"); /* empty file */
+    fclose(fp);
+    EXPECT_EQ_INT(PARSE_EXPECT_VALUE, parse_file(v, path));
+    remove(path);
+    EXPECT_EQ_INT(PARSE_FILE_ERROR, parse_file(v, path));
+    EXPECT_EQ_INT(NONE, v.get_type());
+    EXPECT_EQ_INT(PARSE_FILE_ERROR, doc.parse_file(path));
+}
+
+static void test_parse_depth() {
+    EXPECT_EQ_SIZE_T(1024, get_max_depth());
+    const string ok = string(1024, '[') + string(1024, ']');
+    const string deep = '[' + ok + ']';
+    LeptValue v;
+    EXPECT_EQ_INT(PARSE_OK, parse(v, ok));
+    EXPECT_EQ_INT(PARSE_DEPTH_EXCEEDED, parse(v, deep));
+    EXPECT_EQ_INT(NONE, v.get_type());
+    PushParser p(v);
+    EXPECT_EQ_INT(PARSE_DEPTH_EXCEEDED, p.feed(deep));
+
+    set_max_depth(2);
+    EXPECT_EQ_INT(PARSE_OK, parse(v, "[{\"a\":1},[]]"));
+    EXPECT_EQ_INT(PARSE_DEPTH_EXCEEDED, parse(v, "{\"a\":{\"b\":{}}}"));
+    EXPECT_EQ_INT(PARSE_DEPTH_EXCEEDED, parse(v, "[[[1"));
+    EXPECT_EQ_INT(PARSE_MISS_COMMA_OR_SQUARE_BRACKET, parse(v, "[[1"));
+
+    /* far deeper than the call stack could take, SAX builds no tree */
+    set_max_depth(1000000);
+    const size_t n = 500000;
+    Handler h;
+    EXPECT_EQ_INT(PARSE_OK, parse(h, string(n, '[') + string(n, ']')));
+    EXPECT_EQ_INT(PARSE_MISS_COMMA_OR_SQUARE_BRACKET, parse(h, string(n, '[') + string(n - 1, ']')));
+
+    /* a tree nested deeper than the default limit round-trips */
+    string json;
+    for (int i = 0; i < 5000; ++i) json += "{\"k\":[";
+    json += "null";
+    for (int i = 0; i < 5000; ++i) json += "]}";
+    EXPECT_EQ_INT(PARSE_OK, parse(v, json));
+    EXPECT_TRUE(stringify(v, nullptr) == json);
+    set_max_depth(1024);
+}
+
+static void test_parse_lazy() {
+    const string json =
+        " { \"n\" : null , \"f\" : false , \"t\" : true , \"i\" : -12.5e1 , \"s\" : \"abc\" , "
+        "\"e\\u0041\" : \"x\\ny\" , \"a\" : [ [ ] , { } , [ 1 , [ 2 ] ] , \"]}\" ] , "
+        "\"o\" : { \"k\" : \"v\" } } ";
+    LazyDocument doc;
+    EXPECT_EQ_INT(PARSE_OK, doc.parse(json));
+    LazyValue root = doc.get_root();
+    EXPECT_FALSE(!root);
+    EXPECT_EQ_INT(OBJECT, root.get_type());
+    EXPECT_EQ_SIZE_T(8, root.get_object_size());
+    EXPECT_EQ_INT(NONE, root.get_object_value("n").get_type());
+    EXPECT_FALSE(root.get_object_value("f").get_boolean());
+    EXPECT_TRUE(root.get_object_value("t").get_boolean());
+    EXPECT_EQ_DOUBLE(-125.0, root.get_object_value("i").get_number());
+    EXPECT_EQ_STRING("abc", root.get_object_value("s").get_string(), 3);
+    EXPECT_EQ_STRING("eA", root.get_object_key(5), root.get_object_key(5).size());
+    EXPECT_EQ_STRING("x\ny", root.get_object_value("eA").get_string(), 3);
+    EXPECT_TRUE(!root.get_object_value("missing"));
+
+    LazyValue a = root.get_object_value("a");
+    EXPECT_EQ_SIZE_T(4, a.get_array_size());
+    EXPECT_EQ_SIZE_T(0, a.get_array_element(0).get_array_size());
+    EXPECT_EQ_SIZE_T(0, a.get_array_element(1).get_object_size());
+    EXPECT_EQ_DOUBLE(2.0, a.get_array_element(2).get_array_element(1).get_array_element(0).get_number());
+    EXPECT_EQ_STRING("]}", a.get_array_element(3).get_string(), 2);
+    EXPECT_EQ_STRING("[ 1 , [ 2 ] ]", string(a.get_array_element(2).get_json(), a.get_array_element(2).get_json_length()), 13);
+
+    LeptValue v;
+    EXPECT_EQ_INT(PARSE_OK, root.get_object_value("o").get_value(v));
+    EXPECT_EQ_STRING("{\"k\":\"v\"}", stringify(v, nullptr), stringify(v, nullptr).size());
+    EXPECT_EQ_INT(PARSE_OK, root.get_value(v));
+    LeptValue full;
+    parse(full, json);
+    EXPECT_TRUE(stringify(v, nullptr) == stringify(full, nullptr));
+
+    /* the structural pass finds the full parser's errors, and names them the same */
+    const char* bad[] = {"[1,2", "{\"a\" 1}", "\"\\x\"", "[1] x", "", "[1,]", "{\"a\":1,}", "[01]",
+                         "[1.]", "[-]", "[1e]", "[tru]", "[nul]", "{1:2}", "{\"a\":}", "[\"a\x01\"]",
+                         "[\"\\u12G4\"]", "[\"abc", "[}", "{]", "[1 2]", "\"]\"]", " ", "[[]]]"};
+    for (const char* b : bad) {
+        EXPECT_EQ_INT(parse(v, b), doc.parse(b, strlen(b)));
+        EXPECT_TRUE(!doc.get_root());
+    }
+    set_max_depth(3);
+    EXPECT_EQ_INT(PARSE_OK, doc.parse("[[{}]]", 6));
+    EXPECT_EQ_INT(PARSE_DEPTH_EXCEEDED, doc.parse("[[{\"a\":[]}]]", 12));
+    set_max_depth(1024);
+    /* number range and surrogate pairs wait until the value is read */
+    EXPECT_EQ_INT(PARSE_OK, doc.parse("[1e309,\"\\uD800\"]", 16));
+    EXPECT_EQ_INT(PARSE_NUMBER_TOO_BIG, doc.get_root().get_array_element(0).get_value(v));
+    EXPECT_TRUE(doc.get_root().get_array_element(1).get_string().empty());
+    EXPECT_EQ_INT(PARSE_INVALID_UNICODE_SURROGATE, doc.get_root().get_array_element(1).get_value(v));
+    EXPECT_EQ_INT(PARSE_OK, doc.parse("42", 2));
+    EXPECT_EQ_DOUBLE(42.0, doc.get_root().get_number());
+}
+
+static void test_parse_parallel() {
+    string json = " [";
+    for (int i = 0; i < 3000; ++i) {
+        if (i) json += " , ";
+        json += "{\"id\":" + std::to_string(i) + ",\"s\":\"a,]}\\\"[{\",\"a\":[1,{\"b\":[]}]}";
+    }
+    json += "] ";
+    LeptValue serial, v;
+    EXPECT_EQ_INT(PARSE_OK, parse(serial, json));
+    const string expect = stringify(serial, nullptr);
+    for (unsigned threads = 0; threads <= 4; ++threads) {
+        EXPECT_EQ_INT(PARSE_OK, parse_parallel(v, json, threads));
+        EXPECT_TRUE(stringify(v, nullptr) == expect);
+    }
+
+    /* each error is the one the serial parser reports first */
+    const size_t mid = json.size() / 2;
+    const size_t at = json.find("\"id\"", mid);
+    const char* edits[] = {"x", "1 2", ",,", "\"\\q\"", "[", "]", "\"", "}", "{\"id\"1}"};
+    for (const char* e : edits) {
+        string bad = json;
+        bad.insert(at, e);
+        EXPECT_EQ_INT(parse(v, bad), parse_parallel(v, bad, 4));
+        EXPECT_EQ_INT(NONE, v.get_type());
+    }
+    string bad = json;
+    bad.insert(json.size() - 2, ",");
+    EXPECT_EQ_INT(parse(v, bad), parse_parallel(v, bad, 4));
+    EXPECT_EQ_INT(PARSE_ROOT_NOT_SINGULAR, parse_parallel(v, json + "x", 4));
+
+    /* the depth limit counts the root array */
+    set_max_depth(4);
+    EXPECT_EQ_INT(PARSE_DEPTH_EXCEEDED, parse(v, json));
+    EXPECT_EQ_INT(PARSE_DEPTH_EXCEEDED, parse_parallel(v, json, 4));
+    set_max_depth(5);
+    EXPECT_EQ_INT(PARSE_OK, parse_parallel(v, json, 4));
+    set_max_depth(1024);
+}
+
+static void test_parse_lines() {
+    LineReader r("{\"a\":1}\r\n\n  \r\n[1,\n nul\n\"x\"", 26);
+    EXPECT_TRUE(r.next());
+    EXPECT_EQ_SIZE_T(1, r.get_line());
+    EXPECT_EQ_INT(PARSE_OK, r.get_error());
+    EXPECT_EQ_INT(OBJECT, r.get_value().get_type());
+    EXPECT_TRUE(r.next());
+    EXPECT_EQ_SIZE_T(4, r.get_line());
+    EXPECT_EQ_INT(PARSE_EXPECT_VALUE, r.get_error());
+    EXPECT_EQ_INT(NONE, r.get_value().get_type());
+    EXPECT_TRUE(r.next());
+    EXPECT_EQ_SIZE_T(5, r.get_line());
+    EXPECT_EQ_INT(PARSE_INVALID_VALUE, r.get_error());
+    EXPECT_TRUE(r.next());
+    EXPECT_EQ_SIZE_T(6, r.get_line());
+    EXPECT_EQ_INT(PARSE_OK, r.get_error());
+    EXPECT_EQ_INT(STRING, r.get_value().get_type());
+    EXPECT_FALSE(r.next());
+
+    /* enough lines for several batches, with errors and blank lines among them */
+    string data;
+    for (int i = 0; i < 20000; ++i) {
+        if (i % 997 == 5)
+            data += "{\"id\":" + std::to_string(i) + ",}\n";
+        else if (i % 101 == 7)
+            data += "\r\n";
+        else
+            data += "{\"id\":" + std::to_string(i) + ",\"a\":[true,null,\"s\"]}\r\n";
+    }
+    data += "[0]"; /* no newline after the last record */
+    string expect;
+    LineCallback collect = [&expect](size_t line, int ret, const LeptValue& v) {
+        expect += std::to_string(line) + ":" + std::to_string(ret) + ":" + stringify(v, nullptr) + "\n";
+        return true;
+    };
+    EXPECT_EQ_INT(PARSE_OK, parse_lines(data, collect, 1));
+    EXPECT_TRUE(expect.compare(0, 33, "1:0:{\"id\":0,\"a\":[true,null,\"s\"]}\n") == 0);
+    EXPECT_TRUE(expect.find("\n6:11:null\n") != string::npos);
+    EXPECT_TRUE(expect.find("\n8:") == string::npos);
+    EXPECT_TRUE(expect.compare(expect.size() - 12, 12, "20001:0:[0]\n") == 0);
+    for (unsigned threads = 0; threads <= 4; ++threads) {
+        string got;
+        LineCallback same = [&got](size_t line, int ret, const LeptValue& v) {
+            got += std::to_string(line) + ":" + std::to_string(ret) + ":" + stringify(v, nullptr) + "\n";
+            return true;
+        };
+        EXPECT_EQ_INT(PARSE_OK, parse_lines(data, same, threads));
+        EXPECT_TRUE(got == expect);
+    }
+
+    /* the callback stops it */
+    size_t last = 0;
+    LineCallback stop = [&last](size_t line, int, const LeptValue&) {
+        last = line;
+        return line < 15000;
+    };
+    EXPECT_EQ_INT(PARSE_TERMINATED, parse_lines(data, stop, 4));
+    EXPECT_EQ_SIZE_T(15000, last);
+    EXPECT_EQ_INT(PARSE_OK, parse_lines("", 0, stop, 4));
+
+    /* a throwing callback leaves through the caller, the workers are joined first */
+    LineCallback fail = [](size_t line, int, const LeptValue&) -> bool {
+        if (line == 5000) throw std::runtime_error("callback");
+        return true;
+    };
+    for (unsigned threads = 1; threads <= 4; threads += 3) {
+        bool caught = false;
+        try {
+            parse_lines(data, fail, threads);
+        } catch (const std::runtime_error&) {
+            caught = true;
+        }
+        EXPECT_TRUE(caught);
+    }
+}
+
+struct Point {
+    double x = 0, y = 0;
+};
+LEPT_BIND(Point, LEPT_FIELD(x), LEPT_FIELD(y))
+
+struct Shape {
+    string name;
+    bool closed = false;
+    int32_t id = -1;
+    uint8_t layer = 0;
+    int64_t big = 0;
+    vector<Point> points;
+    vector<vector<string>> tags;
+    Point origin;
+};
+LEPT_BIND(Shape, LEPT_FIELD(name), LEPT_FIELD(closed), LEPT_FIELD(id), LEPT_FIELD(layer), LEPT_FIELD(big),
+          LEPT_FIELD(points), LEPT_FIELD(tags), LEPT_FIELD(origin))
+
+struct Wide {
+    int64_t i = 0;
+    uint64_t u = 0;
+    float f = 0;
+};
+LEPT_BIND(Wide, LEPT_FIELD(i), LEPT_FIELD(u), LEPT_FIELD(f))
+
+static void test_parse_struct() {
+    Shape s;
+    EXPECT_EQ_INT(PARSE_OK, parse_struct(s, "{\"name\":\"tri\\n\",\"extra\":{\"a\":[1,{\"b\":[]}]},\"closed\":true,"
+                                           "\"points\":[{\"x\":1,\"y\":2},{\"y\":-0.5,\"z\":9},{}],"
+                                           "\"tags\":[[],[\"a\",\"b\"]],\"origin\":{\"x\":3},\"big\":-9007199254740992}"));
+    EXPECT_EQ_STRING("tri\n", s.name, s.name.size());
+    EXPECT_TRUE(s.closed);
+    EXPECT_EQ_INT(-1, s.id); /* missing, keeps its value */
+    EXPECT_EQ_SIZE_T(3, s.points.size());
+    EXPECT_EQ_DOUBLE(2.0, s.points[0].y);
+    EXPECT_EQ_DOUBLE(-0.5, s.points[1].y);
+    EXPECT_EQ_DOUBLE(0.0, s.points[2].x);
+    EXPECT_EQ_SIZE_T(2, s.tags[1].size());
+    EXPECT_EQ_STRING("b", s.tags[1][1], s.tags[1][1].size());
+    EXPECT_EQ_DOUBLE(3.0, s.origin.x);
+    EXPECT_TRUE(s.big == -9007199254740992LL);
+
+    /* arrays replace what was there */
+    EXPECT_EQ_INT(PARSE_OK, parse_struct(s, "{\"points\":[],\"id\":7,\"layer\":255}"));
+    EXPECT_EQ_SIZE_T(0, s.points.size());
+    EXPECT_EQ_INT(7, s.id);
+    EXPECT_EQ_INT(255, s.layer);
+
+    /* null leaves a field as it is, like a member that is missing */
+    EXPECT_EQ_INT(PARSE_OK, parse_struct(s, "{\"id\":null,\"name\":null,\"origin\":null,\"tags\":[null,[\"x\"]]}"));
+    EXPECT_EQ_INT(7, s.id);
+    EXPECT_EQ_STRING("tri\n", s.name, s.name.size());
+    EXPECT_EQ_DOUBLE(3.0, s.origin.x);
+    EXPECT_EQ_SIZE_T(2, s.tags.size());
+    EXPECT_EQ_SIZE_T(0, s.tags[0].size());
+
+    const char* mismatch[] = {"{\"id\":1.5}", "{\"layer\":256}", "{\"layer\":-1}", "{\"name\":1}",
+                              "{\"closed\":0}", "{\"points\":{}}", "{\"origin\":[]}", "[]", "{\"tags\":[1]}"};
+    for (const char* json : mismatch) {
+        Shape t;
+        EXPECT_EQ_INT(PARSE_TYPE_MISMATCH, parse_struct(t, json));
+    }
+    Shape t;
+    EXPECT_EQ_INT(PARSE_MISS_COMMA_OR_CURLY_BRACKET, parse_struct(t, "{\"id\":1"));
+    EXPECT_EQ_INT(PARSE_INVALID_VALUE, parse_struct(t, "{\"unknown\":[nul]}"));
+
+    /* integers are read from the text, not through a double */
+    Wide w;
+    EXPECT_EQ_INT(PARSE_OK, parse_struct(w, "{\"i\":9223372036854775807,\"u\":18446744073709551615}"));
+    EXPECT_TRUE(w.i == INT64_MAX);
+    EXPECT_TRUE(w.u == UINT64_MAX);
+    EXPECT_EQ_INT(PARSE_OK, parse_struct(w, "{\"i\":-9223372036854775808,\"u\":9007199254740993}"));
+    EXPECT_TRUE(w.i == INT64_MIN);
+    EXPECT_TRUE(w.u == 9007199254740993ULL);
+    EXPECT_EQ_INT(PARSE_OK, parse_struct(w, "{\"i\":-9007199254740993,\"u\":-0}"));
+    EXPECT_TRUE(w.i == -9007199254740993LL);
+    EXPECT_TRUE(w.u == 0);
+    EXPECT_EQ_INT(PARSE_OK, parse_struct(w, "{\"i\":1000e-3,\"u\":1.2345678901234567890e19}"));
+    EXPECT_TRUE(w.i == 1);
+    EXPECT_TRUE(w.u == 12345678901234567890ULL);
+    EXPECT_EQ_INT(PARSE_OK, parse_struct(w, "{\"f\":-3.4028234e38}"));
+    EXPECT_TRUE(w.f == -std::numeric_limits<float>::max());
+    const char* outOfRange[] = {"{\"i\":9223372036854775808}", "{\"i\":-9223372036854775809}",
+                                "{\"u\":18446744073709551616}", "{\"u\":-1}", "{\"i\":9007199254740993.5}",
+                                "{\"i\":1e19}", "{\"u\":1e-5}", "{\"u\":200000000000000000000e-1}",
+                                "{\"f\":1e300}", "{\"f\":-3.5e38}"};
+    for (const char* json : outOfRange) {
+        Wide x;
+        EXPECT_EQ_INT(PARSE_TYPE_MISMATCH, parse_struct(x, json));
+    }
+}
+
 static void test_parse() {
     test_parse_null();
     test_parse_true();
     test_parse_false();
     test_parse_number();
     test_parse_string();
+    test_parse_string_long();
     test_parse_array();
     test_parse_object();
     test_parse_expect_value();
@@ -368,6 +1086,19 @@ static void test_parse() {
     test_parse_miss_key();
     test_parse_miss_colon();
     test_parse_miss_comma_or_curly_bracket();
+    test_parse_buffer();
+    test_parse_document();
+    test_parse_reuse();
+    test_parse_intern_keys();
+    test_parse_sax();
+    test_parse_insitu();
+    test_parse_push();
+    test_parse_file();
+    test_parse_depth();
+    test_parse_lazy();
+    test_parse_parallel();
+    test_parse_lines();
+    test_parse_struct();
 }
 
 #define TEST_ROUNDTRIP(json)                     \
@@ -399,6 +1130,36 @@ static void test_stringify_number() {
     TEST_ROUNDTRIP("-2.2250738585072014e-308");
     TEST_ROUNDTRIP("1.7976931348623157e+308"); /* Max double */
     TEST_ROUNDTRIP("-1.7976931348623157e+308");
+
+    /* shortest representation, not 17 significant digits */
+    TEST_ROUNDTRIP("0.1");
+    TEST_ROUNDTRIP("0.0001");
+    TEST_ROUNDTRIP("1e-5");
+    TEST_ROUNDTRIP("1e+300");
+    TEST_ROUNDTRIP("5e-324");
+    TEST_ROUNDTRIP("10000000000000000");
+    TEST_ROUNDTRIP("1e+17");
+    TEST_ROUNDTRIP("123456789");
+}
+
+static void test_stringify_number_random() {
+    std::mt19937_64 gen(20161016);
+    int roundtrip = 0, total = 0;
+    for (int i = 0; i < 100000; ++i) {
+        uint64_t bits = gen(), back;
+        double d;
+        memcpy(&d, &bits, sizeof(d));
+        if (std::isnan(d) || std::isinf(d)) continue;
+        LeptValue v, w;
+        v.set_number(d);
+        ++total;
+        if (parse(w, stringify(v, nullptr)) == PARSE_OK && w.get_type() == NUMBER) {
+            d = w.get_number();
+            memcpy(&back, &d, sizeof(back));
+            if (back == bits) ++roundtrip;
+        }
+    }
+    EXPECT_EQ_INT(total, roundtrip);
 }
 
 static void test_stringify_string() {
@@ -407,6 +1168,16 @@ static void test_stringify_string() {
     TEST_ROUNDTRIP("\"Hello\\nWorld\"");
     TEST_ROUNDTRIP("\"\\\" \\\\ / \\b \\f \\n \\r \\t\"");
     TEST_ROUNDTRIP("\"Hello\\u0000World\"");
+    TEST_ROUNDTRIP("\"\\u0001\\u001F\"");
+    TEST_ROUNDTRIP("\"\xE2\x82\xAC \xF0\x9D\x84\x9E\""); /* UTF-8 is written as is */
+
+    for (size_t i = 0; i < 80; ++i) {
+        string plain(i, 'x'), tail(35, '\xC3');
+        LeptValue v;
+        v.set_string(plain + '\x1F' + tail + "\\\"" + plain);
+        EXPECT_TRUE(stringify(v, nullptr) ==
+                    "\"" + plain + "\\u001F" + tail + "\\\\\\\"" + plain + "\"");
+    }
 }
 
 static void test_stringify_array() {
@@ -421,14 +1192,178 @@ static void test_stringify_object() {
         "\"2\":2,\"3\":3}}");
 }
 
+static void test_stringify_writer() {
+    LeptValue v;
+    EXPECT_EQ_INT(PARSE_OK, parse(v, "{\"a\":[1,2.5,\"x\\ny\",null],\"long key here\":{\"b\":true}}"));
+    const string expect = stringify(v, nullptr);
+
+    /* a buffer smaller than most tokens forces every overflow path */
+    for (size_t size = 1; size <= 16; ++size) {
+        string out;
+        size_t calls = 0;
+        CallbackWriter w(
+            [&](const char* data, size_t len) {
+                out.append(data, len);
+                ++calls;
+                return true;
+            },
+            size);
+        EXPECT_TRUE(stringify(v, w));
+        EXPECT_EQ_BASE(expect == out, expect, out, 0);
+        EXPECT_TRUE(calls > 1);
+    }
+
+    size_t calls = 0;
+    CallbackWriter stop([&](const char*, size_t) { return ++calls < 2; }, 4);
+    EXPECT_FALSE(stringify(v, stop));
+    EXPECT_FALSE(stop.good());
+    EXPECT_EQ_SIZE_T(2, calls); /* nothing is sent after the failure */
+
+    string prefix = "data=";
+    {
+        StringWriter w(prefix);
+        EXPECT_TRUE(stringify(v, w));
+    }
+    EXPECT_EQ_BASE("data=" + expect == prefix, "data=" + expect, prefix, 0);
+
+    FILE* fp = tmpfile();
+    EXPECT_TRUE(fp != nullptr);
+    if (fp) {
+        {
+            FileWriter fw(fp, 8);
+            EXPECT_TRUE(stringify(v, fw));
+            fflush(fp);
+            FdWriter dw(fileno(fp), 8); /* appends a second copy through writev */
+            EXPECT_TRUE(stringify(v, dw));
+        }
+        rewind(fp);
+        string content;
+        char buffer[64];
+        size_t n;
+        while ((n = fread(buffer, 1, sizeof(buffer), fp)) > 0) content.append(buffer, n);
+        EXPECT_EQ_BASE(expect + expect == content, expect + expect, content, 0);
+        fclose(fp);
+    }
+}
+
+static void test_stringify_binary() {
+    const string json =
+        "{\"n\":null,\"f\":false,\"t\":true,\"i\":-1.5e-300,\"s\":\"Hello\\u0000World\","
+        "\"a\":[[],{},[1,[2,\"\"]]],\"o\":{\"\":\"empty key\",\"u\":\"\\u20AC\"}}";
+    LeptValue v, w;
+    EXPECT_EQ_INT(PARSE_OK, parse(v, json));
+    const string bin = encode_binary(v);
+    EXPECT_EQ_INT(PARSE_OK, decode_binary(w, bin));
+    EXPECT_TRUE(stringify(w, nullptr) == stringify(v, nullptr));
+    EXPECT_EQ_SIZE_T(11, w.get_object_value(4).get_string_length());
+
+    /* exact doubles, which the text form would print */
+    w.set_number(0.1 + 0.2);
+    EXPECT_EQ_INT(PARSE_OK, decode_binary(v, encode_binary(w)));
+    EXPECT_EQ_DOUBLE(0.1 + 0.2, v.get_number());
+
+    /* large objects get their key index */
+    LeptValue big;
+    big.init_object();
+    for (int i = 0; i < 100; ++i) big.pushback_object_member(std::to_string(i), LeptValue());
+    EXPECT_EQ_INT(PARSE_OK, decode_binary(w, encode_binary(big)));
+    EXPECT_TRUE(w.has_object_index());
+    EXPECT_EQ_SIZE_T(100, w.get_object_capacity());
+    EXPECT_TRUE(w.get_object_value("42") == &w.get_object_value(42));
+
+    string out;
+    CallbackWriter cw([&](const char* data, size_t len) {
+        out.append(data, len);
+        return true;
+    }, 8);
+    EXPECT_TRUE(encode_binary(big, cw));
+    EXPECT_TRUE(out == encode_binary(big));
+
+    for (size_t len = 0; len < bin.size(); ++len) { /* every truncation */
+        EXPECT_EQ_INT(PARSE_INVALID_BINARY, decode_binary(w, bin.data(), len));
+        EXPECT_EQ_INT(NONE, w.get_type());
+    }
+    EXPECT_EQ_INT(PARSE_INVALID_BINARY, decode_binary(w, bin + '\0'));
+    EXPECT_EQ_INT(PARSE_INVALID_BINARY, decode_binary(w, string("LJB\x01\x07", 5)));
+    EXPECT_EQ_INT(PARSE_INVALID_BINARY, decode_binary(w, string("LJB\x02\x00", 5)));
+    EXPECT_EQ_INT(PARSE_INVALID_BINARY, decode_binary(w, string("LJB\x01\x05\xff\xff\xff\xff\x0f", 10)));
+    string deep("LJB\x01", 4);
+    for (int i = 0; i < 1100; ++i) deep += "\x05\x01"; /* arrays of one array */
+    EXPECT_EQ_INT(PARSE_DEPTH_EXCEEDED, decode_binary(w, deep));
+
+    /* trees deeper than the limit encode, and decode once the limit allows them */
+    string nested;
+    for (int i = 0; i < 5000; ++i) nested += "{\"k\":[";
+    nested += "1";
+    for (int i = 0; i < 5000; ++i) nested += "]}";
+    set_max_depth(10001);
+    EXPECT_EQ_INT(PARSE_OK, parse(w, nested));
+    const string tall = encode_binary(w);
+    set_max_depth(1024);
+    EXPECT_EQ_INT(PARSE_DEPTH_EXCEEDED, decode_binary(w, tall));
+    set_max_depth(10001);
+    EXPECT_EQ_INT(PARSE_OK, decode_binary(w, tall));
+    EXPECT_TRUE(stringify(w, nullptr) == nested);
+    set_max_depth(1024);
+
+    /* nested headers that each claim most of the input must not each reserve it */
+    string claims("LJB\x01", 4);
+    for (int i = 0; i < 1000; ++i) claims += string("\x05\x80\x80\x20", 4); /* 2^19 elements */
+    claims.append((size_t)1 << 20, '\0');
+    EXPECT_EQ_INT(PARSE_INVALID_BINARY, decode_binary(w, claims));
+    EXPECT_EQ_INT(NONE, w.get_type());
+}
+
+static void test_stringify_struct() {
+    Shape s;
+    EXPECT_TRUE(stringify_struct(s) ==
+                "{\"name\":\"\",\"closed\":false,\"id\":-1,\"layer\":0,\"big\":0,\"points\":[],\"tags\":[],"
+                "\"origin\":{\"x\":0,\"y\":0}}");
+    s.name = "q\"";
+    s.big = INT64_MIN;
+    s.points.resize(2);
+    s.points[1].x = 0.1;
+    s.tags.push_back(vector<string>(1, "t"));
+    const string json = stringify_struct(s);
+    Shape t;
+    EXPECT_EQ_INT(PARSE_OK, parse_struct(t, json));
+    EXPECT_TRUE(stringify_struct(t) == json);
+    EXPECT_TRUE(t.big == INT64_MIN);
+
+    /* the same text as going through a LeptValue, but integers stay exact */
+    LeptValue v;
+    s.big = 9007199254740993LL;
+    EXPECT_EQ_INT(PARSE_OK, parse(v, stringify_struct(s)));
+    EXPECT_FALSE(stringify(v, nullptr) == stringify_struct(s));
+    s.big = 0;
+    const string small = stringify_struct(s);
+    EXPECT_EQ_INT(PARSE_OK, parse(v, small));
+    EXPECT_TRUE(stringify(v, nullptr) == small);
+
+    Wide w, x;
+    w.i = INT64_MAX;
+    w.u = UINT64_MAX;
+    EXPECT_TRUE(stringify_struct(w) == "{\"i\":9223372036854775807,\"u\":18446744073709551615,\"f\":0}");
+    EXPECT_EQ_INT(PARSE_OK, parse_struct(x, stringify_struct(w)));
+    EXPECT_TRUE(x.i == INT64_MAX && x.u == UINT64_MAX);
+    w.i = -9007199254740993LL;
+    w.u = 9007199254740993ULL;
+    EXPECT_EQ_INT(PARSE_OK, parse_struct(x, stringify_struct(w)));
+    EXPECT_TRUE(x.i == w.i && x.u == w.u);
+}
+
 static void test_stringify() {
     TEST_ROUNDTRIP("null");
     TEST_ROUNDTRIP("false");
     TEST_ROUNDTRIP("true");
     test_stringify_number();
+    test_stringify_number_random();
     test_stringify_string();
     test_stringify_array();
     test_stringify_object();
+    test_stringify_writer();
+    test_stringify_binary();
+    test_stringify_struct();
 }
 
 static void test_access_null() {
@@ -470,11 +1405,390 @@ static void test_access_string() {
     v.freeVal();
 }
 
+static void test_access_array() {
+    LeptValue a, e;
+    a.init_array();
+    e.set_number(1.0);
+    a.pushback_array_element(e);
+    e.set_string("abc");
+    a.pushback_array_element(std::move(e));
+    EXPECT_EQ_INT(NONE, e.get_type());
+    a.insert_array_element(LeptValue(), 0);
+    EXPECT_EQ_SIZE_T(3, a.get_array_size());
+    EXPECT_EQ_INT(NONE, a.get_array_element(0).get_type());
+    EXPECT_EQ_DOUBLE(1.0, a.get_array_element(1).get_number());
+    EXPECT_EQ_STRING("abc", a.get_array_element(2).get_string(),
+                     a.get_array_element(2).get_string_length());
+
+    /* set_array on an array replaces the elements */
+    LeptValue b;
+    b.init_array();
+    b.set_array(vector<LeptValue>(2));
+    EXPECT_EQ_SIZE_T(2, b.get_array_size());
+    vector<LeptValue> elems(4);
+    b.set_array(std::move(elems));
+    EXPECT_EQ_SIZE_T(4, b.get_array_size());
+}
+
+static void test_access_object() {
+    LeptValue o, v;
+    o.init_object();
+    v.set_string("x");
+    o.pushback_object_member("a", v);
+    o.pushback_object_member(string("b"), std::move(v));
+    EXPECT_EQ_INT(NONE, v.get_type());
+    EXPECT_EQ_SIZE_T(2, o.get_object_size());
+    EXPECT_EQ_SIZE_T(1, o.get_object_index("b"));
+    EXPECT_EQ_STRING("x", o.get_object_value(1).get_string(),
+                     o.get_object_value(1).get_string_length());
+    EXPECT_EQ_SIZE_T(KEY_NOT_EXIST, o.get_object_index("c"));
+
+    vector<Member> mems;
+    mems.push_back(Member("k", LeptValue()));
+    o.set_object(mems);
+    EXPECT_EQ_SIZE_T(1, o.get_object_size());
+    o.set_object(vector<Member>());
+    EXPECT_EQ_SIZE_T(0, o.get_object_size());
+}
+
+static size_t linear_object_index(const LeptValue& o, const string& key) {
+    for (size_t i = 0; i < o.get_object_size(); ++i)
+        if (o.get_object_key(i) == key) return i;
+    return KEY_NOT_EXIST;
+}
+
+static void test_access_object_index() {
+    LeptValue o;
+    o.init_object();
+    for (size_t i = 0; i < get_object_index_threshold() - 1; ++i)
+        o.pushback_object_member(std::to_string(i), LeptValue());
+    EXPECT_FALSE(o.has_object_index());
+    for (size_t i = 0; i < 500; ++i) { /* every third key is a duplicate */
+        LeptValue n;
+        n.set_number((double)i);
+        o.pushback_object_member("k" + std::to_string(i % 3 == 0 ? i / 3 : i), std::move(n));
+    }
+    EXPECT_TRUE(o.has_object_index());
+
+    std::mt19937 gen(7);
+    int mismatch = 0;
+    while (o.get_object_size() > 0) {
+        for (size_t i = 0; i < 500; i += 7) {
+            string key = "k" + std::to_string(i);
+            if (o.get_object_index(key) != linear_object_index(o, key)) ++mismatch;
+        }
+        o.remove_object_member(gen() % o.get_object_size());
+    }
+    EXPECT_EQ_INT(0, mismatch);
+
+    string json = "{";
+    for (size_t i = 0; i < 1000; ++i) json += "\"" + std::to_string(i) + "\":" + std::to_string(i) + ",";
+    json.back() = '}';
+    LeptValue v;
+    EXPECT_EQ_INT(PARSE_OK, parse(v, json));
+    EXPECT_TRUE(v.has_object_index());
+    LeptValue w(v);
+    EXPECT_EQ_SIZE_T(999, w.get_object_index("999"));
+    EXPECT_EQ_DOUBLE(123.0, v.get_object_value("123")->get_number());
+    EXPECT_TRUE(v.get_object_value("1000") == nullptr);
+    v.clear_object();
+    EXPECT_FALSE(v.has_object_index());
+
+    size_t threshold = get_object_index_threshold();
+    set_object_index_threshold((size_t)-1);
+    EXPECT_EQ_INT(PARSE_OK, parse(v, json));
+    EXPECT_FALSE(v.has_object_index());
+    EXPECT_EQ_SIZE_T(500, v.get_object_index("500"));
+    set_object_index_threshold(threshold);
+}
+
+static void test_access_move() {
+    LeptValue a;
+    EXPECT_EQ_INT(PARSE_OK, parse(a, "{\"k\":[1,\"s\",{}]}"));
+    LeptValue b(std::move(a));
+    EXPECT_EQ_INT(NONE, a.get_type());
+    EXPECT_EQ_INT(OBJECT, b.get_type());
+    EXPECT_EQ_SIZE_T(3, b.get_object_value(0).get_array_size());
+
+    LeptValue c(b); /* deep copy */
+    b.get_object_value(0).clear_array();
+    EXPECT_EQ_SIZE_T(3, c.get_object_value(0).get_array_size());
+
+    a.set_number(1.0);
+    a = std::move(c);
+    EXPECT_EQ_INT(OBJECT, a.get_type());
+    EXPECT_EQ_INT(NONE, c.get_type());
+    a = std::move(a);
+    EXPECT_EQ_INT(OBJECT, a.get_type());
+}
+
+static void test_access_layout() {
+    EXPECT_TRUE(sizeof(LeptValue) <= 16);
+
+    /* elements of the same array as the argument, across regrowth */
+    LeptValue a;
+    EXPECT_EQ_INT(PARSE_OK, parse(a, "[0,[1,\"s\"],\"t\"]"));
+    for (int i = 0; i < 20; ++i) a.pushback_array_element(a.get_array_element(1));
+    EXPECT_EQ_SIZE_T(23, a.get_array_size());
+    EXPECT_TRUE(stringify(a.get_array_element(22), nullptr) == "[1,\"s\"]");
+    a.insert_array_element(a.get_array_element(2), 0);
+    a.erase_array_element(3, 19);
+    EXPECT_TRUE(stringify(a, nullptr) == "[\"t\",0,[1,\"s\"],[1,\"s\"],[1,\"s\"]]");
+    a.pushback_array_element(std::move(a.get_array_element(0)));
+    EXPECT_TRUE(stringify(a, nullptr) == "[null,0,[1,\"s\"],[1,\"s\"],[1,\"s\"],\"t\"]");
+    a = a.get_array_element(2);
+    EXPECT_TRUE(stringify(a, nullptr) == "[1,\"s\"]");
+    a = std::move(a.get_array_element(1));
+    EXPECT_TRUE(stringify(a, nullptr) == "\"s\"");
+    a.set_string(string(a.get_string(), a.get_string_length()) + "t");
+    EXPECT_EQ_STRING("st", a.get_string(), a.get_string_length());
+
+    a.init_array();
+    EXPECT_EQ_SIZE_T(0, a.get_array_capacity());
+    a.reserve_array(100);
+    EXPECT_EQ_SIZE_T(100, a.get_array_capacity());
+    a.pushback_array_element(LeptValue());
+    a.shrink_array();
+    EXPECT_EQ_SIZE_T(1, a.get_array_capacity());
+    a.popback_array_element();
+    a.shrink_array();
+    EXPECT_EQ_SIZE_T(0, a.get_array_capacity());
+
+    /* strings, arrays and objects of a Document sit in its arena, copies go to the heap */
+    LeptValue copy;
+    {
+        Document doc;
+        EXPECT_EQ_INT(PARSE_OK, doc.parse("{\"a\":[\"a long string, longer than the inline buffer\",\"x\"],\"b\":{}}"));
+        LeptValue& root = doc.get_root();
+        root.get_object_value(1).pushback_object_member("c", root.get_object_value(0));
+        root.get_object_value(0).get_array_element(1).set_string("y", 1, &doc.get_arena());
+        copy = root;
+    }
+    EXPECT_TRUE(stringify(copy, nullptr) ==
+                "{\"a\":[\"a long string, longer than the inline buffer\",\"y\"],"
+                "\"b\":{\"c\":[\"a long string, longer than the inline buffer\",\"x\"]}}");
+
+    /* up to 13 bytes a string is stored in the value itself, past that in one block */
+    size_t wrong = 0;
+    for (size_t len = 0; len < 40; ++len) {
+        const string text(len, (char)('a' + len % 26));
+        a.set_string(text);
+        copy = a;
+        LeptValue moved(std::move(copy));
+        for (const LeptValue* v : {&a, &moved})
+            wrong += v->get_string_length() != len || memcmp(v->get_string(), text.data(), len) != 0 ||
+                     v->get_string()[len] != '\0';
+    }
+    EXPECT_EQ_SIZE_T(0, wrong);
+    a.set_string("0123456789abcdefghij", 20);
+    a.set_string(a.get_string() + 5, 15); /* from its own text, kept in place */
+    EXPECT_EQ_STRING("56789abcdefghij", a.get_string(), a.get_string_length());
+    a.set_string(a.get_string() + 2, 4); /* from its own text, now short */
+    EXPECT_EQ_STRING("789a", a.get_string(), a.get_string_length());
+    a.set_string(a.get_string() + 1, 3);
+    EXPECT_EQ_STRING("89a", a.get_string(), a.get_string_length());
+    a.set_string("a\0b", 3);
+    EXPECT_EQ_STRING("a\0b", a.get_string(), a.get_string_length());
+}
+
+static void test_access_pointer() {
+    LeptValue v;
+    EXPECT_EQ_INT(PARSE_OK, parse(v, "{\"foo\":[\"bar\",\"baz\"],\"\":0,\"a/b\":1,\"c%d\":2,\"e^f\":3,"
+                                     "\"g|h\":4,\"i\\\\j\":5,\"k\\\"l\":6,\" \":7,\"m~n\":8}"));
+    /* the examples of RFC 6901 section 5 */
+    const char* paths[] = {"/", "/a~1b", "/c%d", "/e^f", "/g|h", "/i\\j", "/k\"l", "/ ", "/m~0n"};
+    Pointer ptr;
+    for (int i = 0; i < 9; ++i) {
+        EXPECT_TRUE(ptr.compile(paths[i]));
+        const LeptValue* r = ptr.get(v);
+        EXPECT_TRUE(r != nullptr && r->get_type() == NUMBER && r->get_number() == i);
+    }
+    EXPECT_TRUE(ptr.compile(""));
+    EXPECT_TRUE(ptr.get(v) == &v);
+    EXPECT_TRUE(ptr.compile("/foo/1"));
+    EXPECT_EQ_STRING("baz", ptr.get(v)->get_string(), ptr.get(v)->get_string_length());
+    ptr.get(v)->set_string("qux"); /* non-const lookup */
+    EXPECT_EQ_STRING("qux", v.get_object_value(0).get_array_element(1).get_string(), 3);
+
+    const char* missing[] = {"/foo/2", "/foo/-", "/foo/01", "/foo/0/x", "/x", "/foo/"};
+    for (const char* m : missing) {
+        EXPECT_TRUE(ptr.compile(m));
+        EXPECT_TRUE(ptr.get(v) == nullptr);
+    }
+    EXPECT_FALSE(ptr.compile("foo"));
+    EXPECT_FALSE(ptr.compile("/~2"));
+    EXPECT_FALSE(ptr.compile("/a~"));
+}
+
+static string join_values(const vector<const LeptValue*>& values) {
+    string s;
+    for (const LeptValue* v : values) s += stringify(*v, nullptr) + ' ';
+    return s;
+}
+
+static void test_access_path() {
+    const string json =
+        "{\"store\":{\"book\":[{\"author\":\"A\",\"price\":8},{\"author\":\"B\",\"price\":12},"
+        "{\"author\":\"C\",\"price\":9,\"isbn\":\"x\"}],\"bicycle\":{\"price\":20}}}";
+    LeptValue v;
+    EXPECT_EQ_INT(PARSE_OK, parse(v, json));
+    const char* queries[][2] = {
+        {"$.store.book[*].author", "\"A\" \"B\" \"C\" "},
+        {"$..author", "\"A\" \"B\" \"C\" "},
+        {"$..price", "8 12 9 20 "},
+        {"$.store.*", ""}, /* checked by count below */
+        {"$['store'][\"bicycle\"].price", "20 "},
+        {"$..book[2].isbn", "\"x\" "},
+        {"$..book[0:2].price", "8 12 "},
+        {"$..book[::2].author", "\"A\" \"C\" "},
+        {"$..book[1:].price", "12 9 "},
+        {"$..[1].author", "\"B\" "},
+        {"$.store..*.price", "8 12 9 20 "},
+        {"$.nothing..x", ""},
+        {"$..book[-1].author", "\"C\" "},
+        {"$..book[-2:].price", "12 9 "},
+    };
+    const size_t count = sizeof(queries) / sizeof(queries[0]);
+    vector<Path> compiled(count);
+    vector<const Path*> all;
+    vector<string> expect(count);
+    for (size_t i = 0; i < count; ++i) {
+        EXPECT_TRUE(compiled[i].compile(queries[i][0]));
+        vector<const LeptValue*> out;
+        compiled[i].select(v, out);
+        expect[i] = join_values(out);
+        if (i != 3) EXPECT_EQ_BASE(expect[i] == queries[i][1], queries[i][1], expect[i], 0);
+        all.push_back(&compiled[i]);
+    }
+    vector<const LeptValue*> out;
+    compiled[3].select(v, out);
+    EXPECT_EQ_SIZE_T(2, out.size());
+    Path path;
+    EXPECT_TRUE(path.compile("$"));
+    out.clear();
+    path.select(v, out);
+    EXPECT_TRUE(out.size() == 1 && out[0] == &v);
+    EXPECT_TRUE(path.compile("$..*"));
+    out.clear();
+    path.select(v, out);
+    EXPECT_EQ_SIZE_T(14, out.size());
+
+    /* all paths in one pass over the events, no tree built */
+    vector<string> streamed(count);
+    PathStream stream(all, [&](size_t p, const LeptValue& m) {
+        streamed[p] += stringify(m, nullptr) + ' ';
+        return true;
+    });
+    EXPECT_EQ_INT(PARSE_OK, parse(stream, json));
+    for (size_t i = 0; i < count - 2; ++i) EXPECT_EQ_BASE(expect[i] == streamed[i], expect[i], streamed[i], 0);
+    EXPECT_TRUE(streamed[count - 2].empty() && streamed[count - 1].empty()); /* negative indices */
+
+    /* outer matches come first, even though inner ones finish earlier */
+    vector<const Path*> nested(1, &path);
+    string order;
+    PathStream ns(nested, [&](size_t, const LeptValue& m) {
+        order += stringify(m, nullptr) + ' ';
+        return true;
+    });
+    EXPECT_EQ_INT(PARSE_OK, parse(ns, "[[1,[2]],3]"));
+    EXPECT_EQ_BASE(order == "[1,[2]] 1 [2] 2 3 ", "[1,[2]] 1 [2] 2 3 ", order, 0);
+    size_t calls = 0;
+    PathStream stop(nested, [&](size_t, const LeptValue&) { return ++calls < 2; });
+    EXPECT_EQ_INT(PARSE_TERMINATED, parse(stop, "[1,2,3]"));
+
+    const char* bad[] = {"store", "$.", "$[", "$[1:2:0]", "$['a'", "$[a]", "$..", "$x"};
+    for (const char* b : bad) EXPECT_FALSE(path.compile(b));
+}
+
+static void test_access_tape() {
+    const string json =
+        "{\"n\":null,\"f\":false,\"t\":true,\"i\":123,\"s\":\"abc\\u0000d\","
+        "\"a\":[[],{},[1,[2]],\"x\"],\"o\":{\"1\":1,\"2\":{\"3\":[3]}}}";
+    Tape tape;
+    EXPECT_EQ_INT(PARSE_OK, tape.parse(json));
+    TapeValue root = tape.get_root();
+    EXPECT_EQ_INT(OBJECT, root.get_type());
+    EXPECT_EQ_SIZE_T(7, root.get_object_size());
+    EXPECT_EQ_STRING("s", string(root.get_object_key(4), root.get_object_key_length(4)), 1);
+    EXPECT_EQ_INT(NONE, root.get_object_value("n").get_type());
+    EXPECT_FALSE(root.get_object_value("f").get_boolean());
+    EXPECT_TRUE(root.get_object_value("t").get_boolean());
+    EXPECT_EQ_DOUBLE(123.0, root.get_object_value(3).get_number());
+    EXPECT_EQ_STRING("abc\0d", string(root.get_object_value("s").get_string(), 5), root.get_object_value("s").get_string_length());
+    EXPECT_TRUE(!root.get_object_value("missing"));
+
+    TapeValue a = root.get_object_value("a");
+    EXPECT_EQ_SIZE_T(4, a.get_array_size());
+    EXPECT_EQ_SIZE_T(0, a.get_array_element(0).get_array_size());
+    EXPECT_EQ_SIZE_T(0, a.get_array_element(1).get_object_size());
+    EXPECT_EQ_DOUBLE(2.0, a.get_array_element(2).get_array_element(1).get_array_element(0).get_number());
+    EXPECT_EQ_STRING("x", string(a.get_array_element(3).get_string()), 1); /* skipped the nested arrays */
+    EXPECT_EQ_DOUBLE(3.0, root.get_object_value("o").get_object_value("2").get_object_value("3").get_array_element(0).get_number());
+
+    /* to and from LeptValue */
+    LeptValue v, w;
+    root.get_value(v);
+    parse(w, json);
+    EXPECT_TRUE(stringify(v, nullptr) == stringify(w, nullptr));
+    Tape copy;
+    copy.assign(w);
+    EXPECT_EQ_SIZE_T(tape.get_tape_size(), copy.get_tape_size());
+    EXPECT_EQ_SIZE_T(tape.get_string_buffer_size(), copy.get_string_buffer_size());
+    copy.get_root().get_value(v);
+    EXPECT_TRUE(stringify(v, nullptr) == stringify(w, nullptr));
+
+    EXPECT_EQ_INT(PARSE_MISS_COMMA_OR_SQUARE_BRACKET, tape.parse("[1,2"));
+    EXPECT_TRUE(!tape.get_root());
+    EXPECT_EQ_INT(PARSE_OK, tape.parse(" \"only\" "));
+    EXPECT_EQ_SIZE_T(4, tape.get_root().get_string_length());
+
+    /* in situ the strings stay in the buffer, which must outlive the tape */
+    string buffer(json);
+    EXPECT_EQ_INT(PARSE_OK, tape.parse_insitu(&buffer[0], buffer.size()));
+    EXPECT_EQ_SIZE_T(0, tape.get_string_buffer_size());
+    root = tape.get_root();
+    EXPECT_TRUE(root.get_object_key(0) > buffer.data() && root.get_object_key(0) < buffer.data() + buffer.size());
+    EXPECT_EQ_STRING("abc\0d", string(root.get_object_value("s").get_string(), 5), root.get_object_value("s").get_string_length());
+    root.get_value(v);
+    EXPECT_TRUE(stringify(v, nullptr) == stringify(w, nullptr));
+    copy = tape;
+    EXPECT_EQ_STRING("x", string(copy.get_root().get_object_value("a").get_array_element(3).get_string()), 1);
+    EXPECT_EQ_INT(PARSE_OK, tape.parse("[\"copied\"]"));
+    EXPECT_EQ_SIZE_T(7, tape.get_string_buffer_size());
+
+    /* threads may share one handle, each walks its own stride and moves the common cursor */
+    string list = "[";
+    for (int i = 0; i < 2000; ++i) list += (i ? ",[" : "[") + std::to_string(i) + "]";
+    list += "]";
+    EXPECT_EQ_INT(PARSE_OK, tape.parse(list));
+    const TapeValue shared = tape.get_root();
+    bool found[4] = {};
+    vector<std::thread> readers;
+    for (int t = 0; t < 4; ++t)
+        readers.emplace_back([&shared, &found, t]() {
+            bool ok = true;
+            for (int round = 0; round < 3; ++round)
+                for (size_t i = t; i < 2000; i += 4)
+                    ok = ok && shared.get_array_element(i).get_array_element(0).get_number() == (double)i;
+            found[t] = ok;
+        });
+    for (std::thread& r : readers) r.join();
+    EXPECT_TRUE(found[0] && found[1] && found[2] && found[3]);
+}
+
 static void test_access() {
     test_access_null();
     test_access_boolean();
     test_access_number();
     test_access_string();
+    test_access_array();
+    test_access_object();
+    test_access_object_index();
+    test_access_move();
+    test_access_layout();
+    test_access_pointer();
+    test_access_path();
+    test_access_tape();
 }
 
 }  // namespace lept